@@ -2,7 +2,7 @@
 
 # https://github.com/marcin-filipiak/bash_GCompileAndPack
 
-params=""
+params="-pthread"
 
 # package name from control file
 package_name=$(grep 'Package:' control | cut -d' ' -f2)
@@ -14,10 +14,17 @@ echo "-------------------------------------------"
 echo "                COMPILATION"
 echo "-------------------------------------------"
 g++ -o bin/$package_name src/$package_name.cpp $params
+g++ -O2 -o bin/${package_name}_bench src/${package_name}_bench.cpp $params
 echo "-------------------------------------------"
 echo "             END OF COMPILATION"
 echo "-------------------------------------------"
 
+# "./GCompileAndPack.sh bench" runs the benchmarks instead of the program
+if [ "$1" = "bench" ]; then
+	./bin/${package_name}_bench
+	exit $?
+fi
+
 # Check if compiled file exists before run and asking to create a .deb package
 if [ -f "bin/$package_name" ]; then
 	echo "-------------------------------------------"
@@ -38,9 +45,12 @@ if [ -f "bin/$package_name" ]; then
 		cd todeb
 		mkdir -p DEBIAN
 		mkdir -p usr/bin
+		mkdir -p usr/include
 		mkdir -p etc
 		cd ..
 		cp $package_name todeb/usr/bin
+		ln -s $package_name todeb/usr/bin/${package_name}d
+		cp ../src/${package_name}_shm.h todeb/usr/include
 		cp ../control todeb/DEBIAN
 		dpkg-deb --build todeb
 		rm -rf todeb
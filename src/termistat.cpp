@@ -8,13 +8,39 @@
 #include <cstdio>
 #include <cstdlib>
 #include <sstream>
-#include <iomanip>
 #include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string_view>
+#include <cstring>
+#include <cmath>
+#include <numeric>
+#include <climits>
+#include <unordered_map>
 
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <netdb.h>
+#include <poll.h>
+#include <cerrno>
+#include <charconv>
+
+#include "termistat_shm.h"
 
 void setNonBlocking(bool enable) {
     static struct termios oldt;
@@ -51,332 +77,5936 @@ struct BatteryInfo {
 
 using namespace std;
 
+using Clock = chrono::steady_clock;
+
 /**
- * @brief Clears the terminal screen using ANSI escape codes.
+ * @brief Color depth the terminal is driven with.
  */
-void clearScreen() {
-    cout << "\033[2J\033[1;1H";
-}
+enum class ColorMode { None, Mono, Sixteen, Palette256, TrueColor };
 
 /**
- * @brief Draws a colored progress bar with optional inverted color logic.
+ * @brief Named styles; index into SgrTables.
+ */
+enum Sgr {
+    SgrReset,       ///< Back to default attributes
+    SgrHeader,      ///< Program name in the header row
+    SgrTitle,       ///< Panel titles
+    SgrBarGreen,    ///< Eighth-block bar glyphs, low level, on the track color
+    SgrBarYellow,
+    SgrBarRed,
+    SgrFillGreen,   ///< Whole-cell bar fill, low level
+    SgrFillYellow,
+    SgrFillRed,
+    SgrTrack,       ///< Unused part of a bar
+    SgrSelected,    ///< Selected row of the focused list
+    SgrCount
+};
+
+/**
+ * @brief Every SGR sequence for every color mode, fixed at compile time.
  *
- * Colors indicate usage levels:
- * - Normal mode: Green (low), Yellow (medium), Red (high)
- * - Inverted mode: Red (low), Yellow (medium), Green (high)
+ * Renderers pick a row once at startup and index it per style, so no
+ * escape sequence is formatted while drawing. ColorMode::None (dumb
+ * terminals) has no sequences at all; Mono only uses bold and reverse.
+ */
+constexpr array<array<const char*, SgrCount>, 5> SgrTables = {{
+    // None
+    {{ "", "", "", "", "", "", "", "", "", "", "" }},
+    // Mono
+    {{ "\033[0m", "\033[1m", "\033[1m", "\033[0m", "\033[0m", "\033[0m",
+       "\033[7m", "\033[7m", "\033[7m", "\033[0m", "\033[7m" }},
+    // Sixteen
+    {{ "\033[0m", "\033[1;32m", "\033[1;34m", "\033[32;100m", "\033[33;100m", "\033[31;100m",
+       "\033[42m", "\033[43m", "\033[41m", "\033[100m", "\033[7m" }},
+    // Palette256
+    {{ "\033[0m", "\033[1;38;5;41m", "\033[1;38;5;75m",
+       "\033[38;5;71;48;5;238m", "\033[38;5;178;48;5;238m", "\033[38;5;167;48;5;238m",
+       "\033[48;5;71m", "\033[48;5;178m", "\033[48;5;167m", "\033[48;5;238m", "\033[7m" }},
+    // TrueColor
+    {{ "\033[0m", "\033[1;38;2;80;220;120m", "\033[1;38;2;90;150;250m",
+       "\033[38;2;80;200;120;48;2;60;60;60m", "\033[38;2;230;200;60;48;2;60;60;60m",
+       "\033[38;2;220;70;70;48;2;60;60;60m",
+       "\033[48;2;80;200;120m", "\033[48;2;230;200;60m", "\033[48;2;220;70;70m", "\033[48;2;60;60;60m",
+       "\033[7m" }},
+}};
+
+/**
+ * @brief What the attached terminal can display.
+ */
+struct TerminalCaps {
+    bool unicode = false;               ///< Block, eighth-block and Braille glyphs render correctly
+    bool synchronizedOutput = false;    ///< DEC mode 2026 (synchronized update) is recognised
+    bool cursorAddressing = true;       ///< Cursor movement and screen switching work (false on dumb terminals)
+    ColorMode color = ColorMode::Sixteen;
+
+    /// Escape sequence for @p style in the detected color mode.
+    const char* sgr(Sgr style) const { return SgrTables[int(color)][style]; }
+};
+
+/**
+ * @brief Reads the "colors" capability from the compiled terminfo entry of @p term.
  *
- * @param percent Progress percentage (0-100).
- * @param width Width of the progress bar in characters.
- * @param invertColors Whether to invert the color scheme (default: false).
+ * Handles both the legacy (16-bit) and extended-number (32-bit) formats.
+ *
+ * @return Number of colors, 0 if the entry has none, or -1 if no usable entry was found.
  */
-void drawProgressBar(float percent, int width = 30, bool invertColors = false) {
-    int pos = percent * width / 100;
-    string color;
+int terminfoColors(const string& term) {
+    if (term.empty() || term.find('/') != string::npos)
+        return -1;
 
-    if (!invertColors) {
-        // Normal color scheme: green -> yellow -> red
-        if (percent < 60.0f)
-            color = "\033[42m"; // Green background
-        else if (percent < 85.0f)
-            color = "\033[43m"; // Yellow background
-        else
-            color = "\033[41m"; // Red background
-    } else {
-        // Inverted color scheme: red -> yellow -> green
-        if (percent < 30.0f)
-            color = "\033[41m"; // Red background
-        else if (percent < 75.0f)
-            color = "\033[43m"; // Yellow background
-        else
-            color = "\033[42m"; // Green background
+    vector<string> dirs;
+    if (const char* env = getenv("TERMINFO")) dirs.push_back(env);
+    if (const char* home = getenv("HOME")) dirs.push_back(string(home) + "/.terminfo");
+    if (const char* list = getenv("TERMINFO_DIRS")) {
+        istringstream iss(list);
+        string dir;
+        while (getline(iss, dir, ':'))
+            if (!dir.empty()) dirs.push_back(dir);
     }
+    for (const char* dir : { "/etc/terminfo", "/lib/terminfo", "/usr/share/terminfo" })
+        dirs.push_back(dir);
 
-    cout << "[";
-    for (int i = 0; i < width; ++i) {
-        if (i < pos)
-            cout << color << " " << "\033[0m";  // Colored block for used portion
-        else
-            cout << "\033[100m \033[0m";         // Gray block for remaining portion
+    char hexDir[3];
+    snprintf(hexDir, sizeof(hexDir), "%02x", (unsigned char)term[0]);
+    for (const string& dir : dirs) {
+        for (const string& sub : { string(1, term[0]), string(hexDir) }) {
+            ifstream file(dir + "/" + sub + "/" + term, ios::binary);
+            if (!file.is_open()) continue;
+            string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+            auto u16 = [&](size_t at) {
+                return at + 1 < data.size() ? int((unsigned char)data[at] | (unsigned char)data[at + 1] << 8) : -1;
+            };
+            const int legacyMagic = 0432, extendedMagic = 01036, colorsIndex = 13;
+            int magic = u16(0);
+            if (magic != legacyMagic && magic != extendedMagic) return -1;
+            int namesSize = u16(2), boolCount = u16(4), numCount = u16(6);
+            if (numCount <= colorsIndex) return 0;
+
+            size_t numbers = 12 + namesSize + boolCount;
+            numbers += numbers % 2; // numbers start on an even offset
+            if (magic == legacyMagic) {
+                int value = u16(numbers + colorsIndex * 2);
+                return value == 0xFFFF || value == 0xFFFE ? 0 : value;
+            }
+            size_t at = numbers + colorsIndex * 4;
+            if (at + 3 >= data.size()) return -1;
+            int32_t value = int32_t(uint32_t((unsigned char)data[at]) | uint32_t((unsigned char)data[at + 1]) << 8
+                                    | uint32_t((unsigned char)data[at + 2]) << 16 | uint32_t((unsigned char)data[at + 3]) << 24);
+            return max(0, int(value));
+        }
     }
-    cout << "] " << fixed << setprecision(1) << percent << "%";
+    return -1;
 }
 
 /**
- * @brief Prints a formatted section title in blue bold.
+ * @brief Detects terminal capabilities from the environment and terminfo.
  *
- * @param title Section title text.
+ * Unicode glyphs are used when the locale is UTF-8 and the terminal is not
+ * the Linux console, whose font lacks the eighth blocks. The color mode
+ * comes from COLORTERM (truecolor), then the terminfo "colors" entry, then
+ * the TERM name; NO_COLOR selects monochrome and TERM=dumb disables
+ * escape sequences altogether.
  */
-void drawTitle(const string& title) {
-    cout << "\033[1;34m==== " << title << " ====\033[0m\n";
+TerminalCaps detectTerminalCaps() {
+    TerminalCaps caps;
+    const char* locale = getenv("LC_ALL");
+    if (!locale || !*locale) locale = getenv("LC_CTYPE");
+    if (!locale || !*locale) locale = getenv("LANG");
+    string ctype = locale ? locale : "";
+    transform(ctype.begin(), ctype.end(), ctype.begin(), ::tolower);
+
+    const char* term = getenv("TERM");
+    string termName = term ? term : "";
+    caps.unicode = (ctype.find("utf-8") != string::npos || ctype.find("utf8") != string::npos)
+                && termName != "linux" && termName != "dumb";
+
+    if (termName.empty() || termName == "dumb") {
+        caps.cursorAddressing = false;
+        caps.color = ColorMode::None;
+        return caps;
+    }
+
+    const char* noColor = getenv("NO_COLOR");
+    const char* colorTerm = getenv("COLORTERM");
+    string colorTermName = colorTerm ? colorTerm : "";
+    int colors = terminfoColors(termName);
+    if (colors < 0)
+        colors = termName.find("256color") != string::npos ? 256 : 8;
+
+    if (noColor && *noColor)
+        caps.color = ColorMode::Mono;
+    else if (colorTermName == "truecolor" || colorTermName == "24bit")
+        caps.color = ColorMode::TrueColor;
+    else if (colors >= 256)
+        caps.color = ColorMode::Palette256;
+    else if (colors >= 8)
+        caps.color = ColorMode::Sixteen;
+    else
+        caps.color = ColorMode::Mono;
+    return caps;
 }
 
 /**
- * @brief Displays memory usage statistics with a progress bar.
+ * @brief Short formatted number kept on the stack.
  *
- * Reads /proc/meminfo for total and available memory,
- * calculates usage and displays numeric and graphical info.
+ * Converts to string_view, so it can be handed straight to Panel::text()
+ * without touching the heap or a stream.
  */
-void showMemory() {
-    ifstream meminfo("/proc/meminfo");
-    string line;
-    long memTotal = 0, memAvailable = 0;
+struct NumberText {
+    char data[24];
+    size_t size = 0;
 
-    while (getline(meminfo, line)) {
-        if (line.find("MemTotal:") == 0)
-            memTotal = stol(line.substr(9));
-        if (line.find("MemAvailable:") == 0)
-            memAvailable = stol(line.substr(13));
-    }
+    operator string_view() const { return string_view(data, size); }
+};
+
+/**
+ * @brief Formats @p value with @p precision decimals, independent of the locale.
+ */
+NumberText formatFixed(double value, int precision) {
+    NumberText out;
+    auto result = to_chars(out.data, out.data + sizeof(out.data), value, chars_format::fixed, precision);
+    out.size = result.ec == errc() ? result.ptr - out.data : 0;
+    return out;
+}
 
-    long used = memTotal - memAvailable;
-    float percent = 100.0f * used / memTotal;
+/**
+ * @brief Formats an integer.
+ */
+NumberText formatInt(long long value) {
+    NumberText out;
+    auto result = to_chars(out.data, out.data + sizeof(out.data), value);
+    out.size = result.ptr - out.data;
+    return out;
+}
 
-    drawTitle("Memory");
-    cout << "Used: " << used / 1024 << " MB / " << memTotal / 1024 << " MB\n";
-    drawProgressBar(percent, 40);
-    cout << "\n\n";
+/**
+ * @brief Formats a percentage with one decimal, e.g. "42.5%".
+ */
+NumberText formatPercent(double value) {
+    NumberText out = formatFixed(value, 1);
+    out.data[out.size++] = '%';
+    return out;
 }
 
 /**
- * @brief Reads CPU temperature from sysfs.
+ * @brief Formats @p value scaled into one of @p units, always the same width.
  *
- * @return CPU temperature in degrees Celsius or -1.0 if unavailable.
+ * The result is right-aligned to the widest possible output (four cells
+ * of mantissa, a space and the longest unit), so columns of figures line
+ * up and frames do not jitter as values change.
+ *
+ * @param base Factor between consecutive units (1024 or 1000).
  */
-float readCPUTemperature() {
-    const char* path = "/sys/class/thermal/thermal_zone0/temp";
-    ifstream file(path);
-    if (!file.is_open()) return -1.0f;
+NumberText formatScaled(double value, double base, const array<string_view, 5>& units) {
+    size_t unit = 0;
+    while (value >= base && unit + 1 < units.size()) {
+        value /= base;
+        ++unit;
+    }
 
-    int tempMilliC;
-    file >> tempMilliC;
-    return tempMilliC / 1000.0f;  // Convert millidegrees to degrees Celsius
+    char digits[16];
+    // Whole numbers for the base unit and from 100 up; one decimal otherwise
+    int precision = (unit == 0 || value >= 99.95) ? 0 : 1;
+    auto result = to_chars(digits, digits + sizeof(digits), value, chars_format::fixed, precision);
+    size_t length = result.ec == errc() ? result.ptr - digits : 0;
+
+    size_t unitWidth = 0;
+    for (string_view u : units)
+        unitWidth = max(unitWidth, u.size());
+    const size_t width = 4 + 1 + unitWidth;
+    size_t used = length + 1 + units[unit].size();
+    size_t pad = used < width ? width - used : 0;
+
+    NumberText out;
+    memset(out.data, ' ', pad);
+    char* cursor = out.data + pad;
+    cursor = copy(digits, digits + length, cursor);
+    *cursor++ = ' ';
+    cursor = copy(units[unit].begin(), units[unit].end(), cursor);
+    out.size = cursor - out.data;
+    return out;
 }
 
 /**
- * @brief Attempts to read CPU fan RPM from available hwmon devices.
- *
- * Iterates over /sys/class/hwmon to find fan input files.
+ * @brief Formats a byte count with binary units, e.g. "12.5 MiB".
+ */
+NumberText formatBytes(double bytes) {
+    static constexpr array<string_view, 5> units = { "B", "KiB", "MiB", "GiB", "TiB" };
+    return formatScaled(bytes, 1024.0, units);
+}
+
+/**
+ * @brief Formats a byte rate with binary units, e.g. "  3.4 KiB/s".
+ */
+NumberText formatByteRate(double bytesPerSecond) {
+    static constexpr array<string_view, 5> units = { "B/s", "KiB/s", "MiB/s", "GiB/s", "TiB/s" };
+    return formatScaled(bytesPerSecond, 1024.0, units);
+}
+
+/**
+ * @brief Formats a duration given in nanoseconds, e.g. " 12.5 us".
+ */
+NumberText formatDuration(double nanoseconds) {
+    static constexpr array<string_view, 5> units = { "ns", "us", "ms", "s", "ks" };
+    return formatScaled(nanoseconds, 1000.0, units);
+}
+
+/**
+ * @brief Formats a byte rate as bits per second with decimal units, e.g. "  80 Mb/s".
+ */
+NumberText formatBitRate(double bytesPerSecond) {
+    static constexpr array<string_view, 5> units = { "b/s", "Kb/s", "Mb/s", "Gb/s", "Tb/s" };
+    return formatScaled(bytesPerSecond * 8.0, 1000.0, units);
+}
+
+/**
+ * @brief Rectangle on the terminal, in character cells.
+ */
+struct Rect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * @brief Off-screen frame made of rows split into column slots.
  *
- * @return Fan speed in RPM, or -1 if not available.
+ * Panels write text into the slots of their rectangle; compose() joins
+ * every row, pads each slot to its column and produces the bytes of one
+ * frame. Slot strings keep their capacity between frames.
  */
-int readFanRPM() {
-    const string basePath = "/sys/class/hwmon/";
-    for (const auto& entry : filesystem::directory_iterator(basePath)) {
-        string namePath = entry.path().string() + "/name";
-        ifstream nameFile(namePath);
-        if (!nameFile.is_open()) continue;
+class Screen {
+public:
+    /**
+     * @brief Sets the frame size and the x position where each column starts.
+     */
+    void resize(int width, int height, const vector<int>& columnStarts) {
+        width_ = width;
+        columnStarts_ = columnStarts;
+        rows_.resize(height);
+        for (vector<Cell>& row : rows_)
+            row.resize(columnStarts_.size());
+    }
 
-        string chipName;
-        getline(nameFile, chipName);
+    int width() const { return width_; }
+    int height() const { return int(rows_.size()); }
 
-        // Optional: filter chipName if needed (e.g., == "nct6775")
+    /**
+     * @brief Empties every slot, keeping the allocated memory.
+     */
+    void clear() {
+        for (vector<Cell>& row : rows_)
+            for (Cell& cell : row) {
+                cell.text.clear();
+                cell.width = 0;
+                cell.styled = false;
+            }
+    }
 
-        for (int i = 1; i <= 5; ++i) {
-            string fanPath = entry.path().string() + "/fan" + to_string(i) + "_input";
-            ifstream fanFile(fanPath);
-            if (fanFile.is_open()) {
-                int rpm;
-                fanFile >> rpm;
-                if (rpm > 0)
-                    return rpm;
+    /**
+     * @brief Empties the slots of @p column in rows [@p firstRow, @p firstRow + @p rows).
+     */
+    void clearSlots(int column, int firstRow, int rows) {
+        for (int y = firstRow; y < firstRow + rows && y < height(); ++y) {
+            Cell& cell = rows_[y][column];
+            cell.text.clear();
+            cell.width = 0;
+            cell.styled = false;
+        }
+    }
+
+    /**
+     * @brief Appends the frame to @p out.
+     *
+     * A slot wider than its column (such as a full-width header) pushes
+     * the following empty slots of that row aside.
+     *
+     * @param caps Decides whether the frame starts at the top-left corner
+     *             and how styled slots are reset.
+     */
+    void compose(string& out, const TerminalCaps& caps) const {
+        if (caps.cursorAddressing)
+            out += "\033[H";
+        for (size_t y = 0; y < rows_.size(); ++y) {
+            int x = 0;
+            for (size_t c = 0; c < columnStarts_.size(); ++c) {
+                const Cell& cell = rows_[y][c];
+                if (x > columnStarts_[c] && cell.width == 0)
+                    continue;
+                if (x < columnStarts_[c]) {
+                    out.append(columnStarts_[c] - x, ' ');
+                    x = columnStarts_[c];
+                }
+                out += cell.text;
+                if (cell.styled)
+                    out += caps.sgr(SgrReset);
+                x += cell.width;
             }
+            if (x < width_)
+                out.append(width_ - x, ' ');
+            if (y + 1 < rows_.size())
+                out += '\n';
         }
     }
-    return -1;
-}
+
+private:
+    friend class Panel;
+
+    struct Cell {
+        string text;        ///< Bytes, including escape sequences
+        int width = 0;      ///< Display width in cells
+        bool styled = false;
+    };
+
+    Cell& cell(int y, int column) { return rows_[y][column]; }
+
+    int width_ = 0;
+    vector<int> columnStarts_;
+    vector<vector<Cell>> rows_;
+};
 
 /**
- * @brief Displays CPU usage, temperature, and fan speed with progress bars.
+ * @brief Writer that draws into one rectangle of a Screen.
  *
- * Parses /proc/stat to calculate CPU usage delta,
- * reads CPU temperature and fan RPM if available.
+ * Text is clipped at the right edge and lines past the bottom edge are
+ * dropped, so renderers never draw outside the area they were assigned.
+ * Every glyph used by termistat occupies one cell, so the display width is
+ * the number of UTF-8 code points.
  */
-void showCPU() {
-    static long prevIdle = 0, prevTotal = 0;
+class Panel {
+public:
+    Panel(Screen& screen, const Rect& rect, int column)
+        : screen_(screen), rect_(rect), column_(column) {}
 
-    ifstream stat("/proc/stat");
-    string cpu;
-    long user, nice, system, idle, iowait, irq, softirq;
-    stat >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq;
+    int width() const { return rect_.width; }
+    int height() const { return rect_.height; }
+    const Rect& rect() const { return rect_; }
+    /// Index of the current line, -1 before the first newLine().
+    int row() const { return row_; }
 
-    long idleTime = idle + iowait;
-    long totalTime = user + nice + system + idleTime + irq + softirq;
+    /// Lines that can still be started.
+    int rowsLeft() const { return rect_.height - row_ - 1; }
+
+    /**
+     * @brief Starts the next line.
+     *
+     * @return false once the panel is full; text written afterwards is dropped.
+     */
+    bool newLine() {
+        ++row_;
+        cell_ = row_ < rect_.height ? &screen_.cell(rect_.y + row_, column_) : nullptr;
+        return cell_ != nullptr;
+    }
 
-    long deltaIdle = idleTime - prevIdle;
-    long deltaTotal = totalTime - prevTotal;
-    float usage = 0.0f;
-    if (deltaTotal != 0)
-        usage = 100.0f * (deltaTotal - deltaIdle) / deltaTotal;
+    /**
+     * @brief Appends printable text to the current line, clipped to the panel width.
+     */
+    void text(string_view s) {
+        if (!cell_) return;
+        size_t end = 0;
+        int width = cell_->width;
+        for (; end < s.size(); ++end) {
+            if ((s[end] & 0xC0) != 0x80) { // first byte of a code point
+                if (width == rect_.width) break;
+                ++width;
+            }
+        }
+        cell_->text.append(s.data(), end);
+        cell_->width = width;
+    }
 
-    prevIdle = idleTime;
-    prevTotal = totalTime;
+    /**
+     * @brief Appends several pieces of text (strings, literals, NumberText) in a row.
+     */
+    template <typename... Parts>
+    void print(const Parts&... parts) {
+        (text(string_view(parts)), ...);
+    }
 
-    float temp = readCPUTemperature();
+    /**
+     * @brief Appends a zero-width escape sequence to the current line.
+     */
+    void style(string_view sgr) {
+        if (!cell_ || sgr.empty()) return;
+        cell_->text += sgr;
+        cell_->styled = true;
+    }
 
-    drawTitle("CPU");
-    cout << "Usage: ";
-    drawProgressBar(usage, 40);
-    cout << "\n";
+    /**
+     * @brief Starts a new line holding @p s.
+     */
+    bool line(string_view s) {
+        if (!newLine()) return false;
+        text(s);
+        return true;
+    }
 
-    if (temp > 0)
-        cout << "Temp: " << fixed << setprecision(1) << temp << " °C\n";
+    /// Cells left on the current line.
+    int columnsLeft() const { return cell_ ? rect_.width - cell_->width : 0; }
 
-    int fanRPM = readFanRPM();
-    if (fanRPM > 0)
-        cout << "Fan:  " << fanRPM << " RPM\n";
+private:
+    Screen& screen_;
+    Rect rect_;
+    int column_;
+    int row_ = -1;
+    Screen::Cell* cell_ = nullptr;
+};
 
-    cout << "\n";
-}
+/// Left-aligned partial blocks, indexed by filled eighths (0 = empty cell).
+constexpr array<const char*, 9> EighthBlocks = {
+    " ", "▏", "▎", "▍", "▌", "▋", "▊", "▉", "█"
+};
 
 /**
- * @brief Reads battery capacity and status from sysfs.
+ * @brief Draws a colored progress bar with optional inverted color logic.
  *
- * @return BatteryInfo struct with capacity, status, and availability.
+ * Colors indicate usage levels:
+ * - Normal mode: Green (low), Yellow (medium), Red (high)
+ * - Inverted mode: Red (low), Yellow (medium), Green (high)
+ *
+ * With Unicode the used portion is drawn with eighth blocks, giving eight
+ * steps per cell; otherwise whole colored cells are used. The bar shrinks
+ * to fit the rest of the current line.
+ *
+ * @param panel Panel whose current line receives the bar.
+ * @param percent Progress percentage (0-100).
+ * @param width Width of the progress bar in characters.
+ * @param invertColors Whether to invert the color scheme.
+ * @param caps Decides between eighth blocks, colored cells and plain ASCII.
  */
-BatteryInfo readBattery() {
-    BatteryInfo info{ -1, "Unknown", false };
-    const std::string basePath = "/sys/class/power_supply/";
-    const std::string batteryPath = basePath + "BAT0/";
+void drawProgressBar(Panel& panel, float percent, int width, bool invertColors, const TerminalCaps& caps) {
+    const int suffix = 10; // "[", "] 100.0%"
+    width = max(1, min(width, panel.columnsLeft() - suffix));
 
-    ifstream capFile(batteryPath + "capacity");
-    ifstream statusFile(batteryPath + "status");
+    // 0 = green, 1 = yellow, 2 = red
+    int level;
+    if (!invertColors) {
+        // Normal color scheme: green -> yellow -> red
+        level = percent < 60.0f ? 0 : percent < 85.0f ? 1 : 2;
+    } else {
+        // Inverted color scheme: red -> yellow -> green
+        level = percent < 30.0f ? 2 : percent < 75.0f ? 1 : 0;
+    }
+    static const string blanks(256, ' ');
+    static const string hashes(256, '#');
+    static const string dots(256, '.');
+    width = min(width, int(blanks.size()));
 
-    if (capFile.is_open() && statusFile.is_open()) {
-        capFile >> info.capacity;
-        getline(statusFile, info.status);
-        info.available = true;
+    panel.text("[");
+    if (caps.unicode) {
+        int eighths = clamp(int(percent * width * 8 / 100 + 0.5f), 0, width * 8);
+        int full = eighths / 8, partial = eighths % 8;
+        panel.style(caps.sgr(Sgr(SgrBarGreen + level)));
+        for (int i = 0; i < full; ++i)
+            panel.text(EighthBlocks[8]);
+        if (partial > 0)
+            panel.text(EighthBlocks[partial]);
+        panel.text(string_view(blanks.data(), width - full - (partial > 0)));
+    } else if (caps.color != ColorMode::None) {
+        int pos = clamp(int(percent * width / 100), 0, width);
+        panel.style(caps.sgr(Sgr(SgrFillGreen + level)));  // Colored block for used portion
+        panel.text(string_view(blanks.data(), pos));
+        panel.style(caps.sgr(SgrTrack));                    // Gray block for remaining portion
+        panel.text(string_view(blanks.data(), width - pos));
+    } else {
+        int pos = clamp(int(percent * width / 100), 0, width);
+        panel.text(string_view(hashes.data(), pos));
+        panel.text(string_view(dots.data(), width - pos));
     }
+    panel.style(caps.sgr(SgrReset));
+    panel.print("] ", formatPercent(percent));
+}
 
-    return info;
+/**
+ * @brief Starts a panel with its section title in blue bold.
+ *
+ * @param title Section title text.
+ * @param caps Selects the title style for the color mode.
+ */
+void drawTitle(Panel& panel, const string& title, const TerminalCaps& caps) {
+    if (!panel.newLine()) return;
+    panel.style(caps.sgr(SgrTitle));
+    panel.text("==== ");
+    panel.text(title);
+    panel.text(" ====");
+    panel.style(caps.sgr(SgrReset));
 }
 
+/// Sparkline glyphs from an empty cell to a full one, in eighths.
+constexpr array<const char*, 9> SparkGlyphs = {
+    " ", "\u2581", "\u2582", "\u2583", "\u2584", "\u2585", "\u2586", "\u2587", "\u2588"
+};
+
+/// ASCII stand-ins for SparkGlyphs on terminals without Unicode.
+constexpr array<const char*, 9> AsciiSparkGlyphs = { " ", ".", ",", "-", "~", "=", "+", "*", "#" };
+
 /**
- * @brief Displays battery status and charge percentage with an inverted color progress bar.
+ * @brief UTF-8 encodings of all 256 Braille patterns, indexed by dot mask.
  */
-void showBattery() {
-    BatteryInfo bat = readBattery();
-    drawTitle("Battery");
+struct BrailleTable {
+    array<array<char, 3>, 256> glyphs{};
 
-    if (bat.available) {
-        cout << bat.status << "\n";
-        drawProgressBar(bat.capacity, 40, true);
-        cout << "\n\n";
-    } else {
-        cout << "Battery info not available\n\n";
+    constexpr BrailleTable() {
+        for (int mask = 0; mask < 256; ++mask) {
+            // U+2800 + mask encodes as E2 A0|(mask >> 6) 80|(mask & 3F)
+            glyphs[mask][0] = char(0xE2);
+            glyphs[mask][1] = char(0xA0 | (mask >> 6));
+            glyphs[mask][2] = char(0x80 | (mask & 0x3F));
+        }
+    }
+};
+
+constexpr BrailleTable Braille;
+
+/// Braille dot bit for [row from top][column] inside one cell.
+constexpr uint8_t BrailleDots[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+
+/// Widest graph, in sample columns, the renderers support.
+constexpr size_t MaxGraphColumns = 512;
+
+/**
+ * @brief Reduces @p n samples to @p columns min/max pairs.
+ *
+ * Each column covers an equal share of the input, so spikes survive
+ * downsampling. Requires n >= columns.
+ */
+void downsampleMinMax(const float* values, size_t n, size_t columns, float* mins, float* maxs) {
+    for (size_t c = 0; c < columns; ++c) {
+        size_t begin = c * n / columns;
+        size_t end = (c + 1) * n / columns;
+        float lo = values[begin], hi = values[begin];
+        for (size_t i = begin + 1; i < end; ++i) {
+            lo = min(lo, values[i]);
+            hi = max(hi, values[i]);
+        }
+        mins[c] = lo;
+        maxs[c] = hi;
     }
 }
 
 /**
- * @brief Displays disk usage for mounted filesystems excluding system and device mounts.
+ * @brief Appends a one-row sparkline of @p width cells, newest sample on the right.
  *
- * Uses statvfs to retrieve space information and displays usage percentage.
+ * @param scale Value drawn as a full cell.
  */
-void showDisk() {
-    drawTitle("Disks");
-    ifstream mounts("/proc/mounts");
-    string line;
+void appendSparkline(string& out, const float* values, size_t n, size_t width, float scale,
+                     bool unicode = true) {
+    const array<const char*, 9>& glyphs = unicode ? SparkGlyphs : AsciiSparkGlyphs;
+    width = min(width, MaxGraphColumns);
+    size_t columns = min(n, width);
+    float mins[MaxGraphColumns], maxs[MaxGraphColumns];
+    if (columns > 0) {
+        size_t used = n / columns * columns; // drop the oldest remainder so columns stay equal
+        downsampleMinMax(values + n - used, used, columns, mins, maxs);
+    }
 
-    while (getline(mounts, line)) {
-        istringstream iss(line);
-        string device, mountpoint;
-        iss >> device >> mountpoint;
+    out.append(width - columns, ' ');
+    for (size_t c = 0; c < columns; ++c) {
+        int level = scale > 0 ? int(maxs[c] / scale * 8.0f + 0.5f) : 0;
+        if (level == 0 && maxs[c] > 0) level = 1; // keep non-zero samples visible
+        out += glyphs[clamp(level, 0, 8)];
+    }
+}
 
-        // Skip device and system mounts
-        if (mountpoint.find("/dev") != string::npos || mountpoint.find("/sys") != string::npos)
-            continue;
+/**
+ * @brief Appends a Braille line graph of @p width x @p height cells.
+ *
+ * Every cell holds 2x4 dots; each dot column spans the min..max of the
+ * samples it covers. Rows are separated by "\n" followed by @p indent.
+ *
+ * @param scale Value drawn at the top edge.
+ */
+void appendBrailleGraph(string& out, const float* values, size_t n, size_t width, size_t height,
+                        float scale, const string& indent) {
+    const size_t maxHeight = 8;
+    width = min(width, MaxGraphColumns / 2);
+    height = min(height, maxHeight);
+    size_t dotColumns = min(n, width * 2);
+    float mins[MaxGraphColumns], maxs[MaxGraphColumns];
+    if (dotColumns > 0) {
+        size_t used = n / dotColumns * dotColumns;
+        downsampleMinMax(values + n - used, used, dotColumns, mins, maxs);
+    }
 
-        struct statvfs stat;
-        if (statvfs(mountpoint.c_str(), &stat) == 0) {
-            unsigned long long total = stat.f_blocks * stat.f_frsize;
-            unsigned long long free = stat.f_bfree * stat.f_frsize;
-            unsigned long long used = total - free;
-            float percent = 100.0f * used / total;
+    uint8_t cells[maxHeight][MaxGraphColumns / 2] = {};
+    int dotRows = int(height * 4);
+    size_t firstColumn = width * 2 - dotColumns; // right-align newest samples
+    for (size_t c = 0; c < dotColumns; ++c) {
+        auto toRow = [&](float v) { // dot row counted from the bottom
+            return scale > 0 ? clamp(int(v / scale * (dotRows - 1) + 0.5f), 0, dotRows - 1) : 0;
+        };
+        size_t x = firstColumn + c;
+        for (int y = toRow(mins[c]); y <= toRow(maxs[c]); ++y) {
+            int fromTop = dotRows - 1 - y;
+            cells[fromTop / 4][x / 2] |= BrailleDots[fromTop % 4][x % 2];
+        }
+    }
 
-            cout << mountpoint << ": "
-                 << used / (1024 * 1024) << " MB / "
-                 << total / (1024 * 1024) << " MB ("
-                 << fixed << setprecision(1) << percent << "%)\n";
+    for (size_t row = 0; row < height; ++row) {
+        if (row > 0) {
+            out += '\n';
+            out += indent;
         }
+        for (size_t x = 0; x < width; ++x)
+            out.append(Braille.glyphs[cells[row][x]].data(), 3);
     }
-    cout << "\n";
 }
 
 /**
- * @brief Displays network interface RX and TX statistics, including WiFi signal if available.
+ * @brief CLOCK_MONOTONIC_RAW in nanoseconds.
  *
- * Parses /proc/net/dev for interface byte counters,
- * uses iwconfig output to find wireless signal strength.
+ * Not slewed by NTP, and read through the vDSO without a system call, so
+ * it is cheap enough to bracket every collector and render stage.
  */
-void showNetwork() {
-    drawTitle("Network");
+int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
 
-    ifstream net("/proc/net/dev");
-    string line;
-    getline(net, line); // skip header
-    getline(net, line); // skip header
+/**
+ * @brief Log-linear latency histogram in the style of HdrHistogram.
+ *
+ * Values are bucketed by their power of two and then linearly into
+ * SubBuckets steps within it, so every percentile is within 1/SubBuckets
+ * (about 6%) of the true value from nanoseconds to over an hour, using a
+ * fixed array of counters. Counters are relaxed atomics, so one thread can
+ * record while another reads.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SubBits = 4;
+    static constexpr uint64_t SubBuckets = 1 << SubBits;
+    static constexpr int Octaves = 42;     ///< Covers up to 2^45 ns
 
-    while (getline(net, line)) {
-        istringstream iss(line);
-        string iface;
-        getline(iss, iface, ':');
-        string trimmed_iface = iface;
-        trimmed_iface.erase(remove(trimmed_iface.begin(), trimmed_iface.end(), ' '), trimmed_iface.end());
+    void add(uint64_t value) {
+        counts_[bucket(value)].fetch_add(1, memory_order_relaxed);
+        total_.fetch_add(1, memory_order_relaxed);
+        uint64_t seen = max_.load(memory_order_relaxed);
+        while (value > seen && !max_.compare_exchange_weak(seen, value, memory_order_relaxed)) {}
+    }
 
-        long rx, tx;
-        iss >> rx;
-        for (int i = 0; i < 7; ++i) iss >> tx; // skip fields to reach tx
+    uint64_t count() const { return total_.load(memory_order_relaxed); }
+    uint64_t max() const { return max_.load(memory_order_relaxed); }
 
-        cout << trimmed_iface << " → RX: " << rx / 1024 << " KB, TX: " << tx / 1024 << " KB\n";
+    /**
+     * @brief Smallest bucket value that at least @p percent of the samples do not exceed.
+     */
+    uint64_t percentile(double percent) const {
+        uint64_t total = count();
+        if (total == 0 || percent >= 100.0)
+            return max();
+        uint64_t rank = std::max<uint64_t>(1, uint64_t(ceil(total * percent / 100.0)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i].load(memory_order_relaxed);
+            if (seen >= rank)
+                return min(bucketMiddle(i), max());
+        }
+        return max();
     }
 
-    // Retrieve WiFi signal level if available
-    FILE* fp = popen("iwconfig 2>/dev/null", "r");
-    if (fp) {
-        char buffer[256];
-        while (fgets(buffer, sizeof(buffer), fp)) {
-            string s(buffer);
-            if (s.find("Signal level=") != string::npos) {
-                size_t pos = s.find("Signal level=");
-                cout << "\nWiFi Signal: " << s.substr(pos);
-            }
-        }
-        pclose(fp);
+private:
+    static size_t bucket(uint64_t value) {
+        if (value < SubBuckets)
+            return value;
+        int exponent = 63 - __builtin_clzll(value);
+        size_t index = size_t(exponent - SubBits + 1) * SubBuckets + ((value >> (exponent - SubBits)) & (SubBuckets - 1));
+        return min(index, size_t(Octaves) * SubBuckets - 1);
     }
-    cout << "\n";
-}
+
+    static uint64_t bucketMiddle(size_t index) {
+        uint64_t octave = index / SubBuckets;
+        uint64_t sub = index % SubBuckets;
+        if (octave == 0)
+            return sub;
+        uint64_t low = (SubBuckets + sub) << (octave - 1);
+        return low + ((uint64_t(1) << (octave - 1)) >> 1);
+    }
+
+    array<atomic<uint32_t>, size_t(Octaves) * SubBuckets> counts_{};
+    atomic<uint64_t> total_{0};
+    atomic<uint64_t> max_{0};
+};
+
+class TraceWriter;
+
+/// Trace of the current run, or nullptr without --trace.
+TraceWriter* activeTrace = nullptr;
 
 /**
- * @brief Main application loop.
+ * @brief Collects timed events and writes them as Chrome trace JSON.
  *
- * Clears the screen, displays all system statistics every second.
+ * Events are buffered under a mutex and written by flush(), which the
+ * main loop calls once per frame, so worker threads never wait on the
+ * file. The JSON array format is used, which chrome://tracing and
+ * Perfetto also load when the closing bracket is missing after a crash.
  */
-int main() {
-    cout << "Press ENTER to quit\n";
-    setNonBlocking(true);
+class TraceWriter {
+public:
+    explicit TraceWriter(const string& path) : file_(fopen(path.c_str(), "w")) {
+        if (file_)
+            fputs("[\n", file_);
+    }
 
-    while (true) {
-        clearScreen();
-        cout << "\033[1;32m*** TermiStat ***\033[0m\n\n";
+    ~TraceWriter() {
+        if (activeTrace == this)
+            activeTrace = nullptr;
+        if (!file_) return;
+        flush();
+        fputs("\n]\n", file_);
+        fclose(file_);
+    }
 
-        showMemory();
-        showCPU();
-        showBattery();
-        showDisk();
-        showNetwork();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
 
-        using namespace std::chrono_literals;
-        for (int i = 0; i < 10; ++i) { // 1 sec total
-            std::this_thread::sleep_for(100ms);
-            char c;
-            ssize_t n = read(STDIN_FILENO, &c, 1);
-            if (n > 0 && (c == '\n' || c == '\r')) {
-                setNonBlocking(false);
-                return 0; // exit on Enter
-            }
+    bool ok() const { return file_ != nullptr; }
+
+    /**
+     * @brief Buffers a complete ("X") event.
+     *
+     * @param name Must outlive the writer; string literals and collector names do.
+     */
+    void record(const char* name, const char* category, int64_t startNs, int64_t durationNs) {
+        static atomic<uint32_t> nextThread{1};
+        thread_local uint32_t thread = nextThread.fetch_add(1, memory_order_relaxed);
+        lock_guard<mutex> lock(mutex_);
+        events_.push_back({ name, category, startNs, durationNs, thread });
+    }
+
+    /// Writes the buffered events to the file.
+    void flush() {
+        vector<Event> events;
+        {
+            lock_guard<mutex> lock(mutex_);
+            events.swap(events_);
+        }
+        for (const Event& e : events) {
+            fprintf(file_, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+                    first_ ? "" : ",\n", e.name, e.category, e.startNs / 1000.0, e.durationNs / 1000.0,
+                    int(getpid()), e.thread);
+            first_ = false;
         }
+        fflush(file_);
     }
-    setNonBlocking(false);
-    return 0;
-}
 
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        int64_t startNs;
+        int64_t durationNs;
+        uint32_t thread;
+    };
+
+    FILE* file_;
+    mutex mutex_;
+    vector<Event> events_;
+    bool first_ = true;
+};
+
+/**
+ * @brief Running cost of a hot path: last duration and latency distribution.
+ *
+ * Updated with relaxed atomics, so collectors can record from worker
+ * threads while the renderer reads.
+ */
+struct CostCounter {
+    atomic<int64_t> lastNs{0};
+    LatencyHistogram histogram;
+
+    void add(int64_t ns) {
+        lastNs.store(ns, memory_order_relaxed);
+        histogram.add(uint64_t(max<int64_t>(0, ns)));
+    }
+};
 
+/**
+ * @brief Adds the time until the end of the enclosing scope to a CostCounter
+ *        and, with --trace, emits it as a trace event.
+ */
+class ScopedTimer {
+public:
+    ScopedTimer(CostCounter& counter, const char* name, const char* category)
+        : counter_(&counter), name_(name), category_(category), start_(monotonicNs()) {}
+
+    /// Times a step inside an already counted one, for the trace only.
+    ScopedTimer(const char* name, const char* category)
+        : counter_(nullptr), name_(name), category_(category), start_(activeTrace ? monotonicNs() : 0) {}
+
+    ~ScopedTimer() {
+        if (!counter_ && !activeTrace)
+            return;
+        int64_t elapsed = monotonicNs() - start_;
+        if (counter_)
+            counter_->add(elapsed);
+        if (activeTrace)
+            activeTrace->record(name_, category_, start_, elapsed);
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    CostCounter* counter_;
+    const char* name_;
+    const char* category_;
+    int64_t start_;
+};
+
+/**
+ * @brief Immutable list shared by every snapshot that holds it.
+ *
+ * Collectors build a fresh vector per sample and freeze it here, so
+ * assembling, recording and redrawing snapshots never copies the entries,
+ * however many mounts or interfaces a host has.
+ */
+template <typename T>
+class SharedList {
+public:
+    SharedList() = default;
+    SharedList(vector<T>&& entries) : entries_(make_shared<const vector<T>>(move(entries))) {}
+
+    const vector<T>& items() const {
+        static const vector<T> none;
+        return entries_ ? *entries_ : none;
+    }
+    size_t size() const { return items().size(); }
+    bool empty() const { return items().empty(); }
+    const T& operator[](size_t index) const { return items()[index]; }
+    auto begin() const { return items().begin(); }
+    auto end() const { return items().end(); }
+
+private:
+    shared_ptr<const vector<T>> entries_;
+};
+
+/**
+ * @brief Memory usage sample read from /proc/meminfo.
+ */
+struct MemorySnapshot {
+    long totalKB = 0;       ///< MemTotal in KiB
+    long availableKB = 0;   ///< MemAvailable in KiB
+};
+
+/**
+ * @brief CPU usage sample.
+ */
+struct CPUSnapshot {
+    float usage = 0.0f;         ///< Usage percentage since the previous sample
+    bool sampled = false;       ///< False in the empty section of a suspended or not yet run collector
+};
+
+/**
+ * @brief Temperature and fan readings from thermal zones and hwmon.
+ */
+struct SensorSnapshot {
+    float temperature = -1.0f;  ///< Temperature in degrees Celsius, or -1 if unavailable
+    int fanRPM = -1;            ///< Fan speed in RPM, or -1 if unavailable
+};
+
+/**
+ * @brief Space usage of a single mounted filesystem.
+ */
+struct DiskInfo {
+    string mountpoint;              ///< Mount point path
+    unsigned long long totalBytes;  ///< Filesystem size in bytes
+    unsigned long long usedBytes;   ///< Used space in bytes
+};
+
+/**
+ * @brief Whole-disk read and write throughput.
+ */
+struct DiskIOSnapshot {
+    double readRate = 0.0;      ///< Bytes read per second
+    double writeRate = 0.0;     ///< Bytes written per second
+    bool sampled = false;       ///< False in the empty section of a suspended or not yet run collector
+};
+
+/**
+ * @brief Cumulative byte counters of a single network interface.
+ */
+struct NetInterfaceInfo {
+    string name;            ///< Interface name
+    long long rxBytes;      ///< Received bytes since boot
+    long long txBytes;      ///< Transmitted bytes since boot
+    double rxRate = 0.0;    ///< Received bytes per second since the previous sample
+    double txRate = 0.0;    ///< Transmitted bytes per second since the previous sample
+};
+
+/**
+ * @brief Network interfaces sample.
+ */
+struct NetworkSnapshot {
+    SharedList<NetInterfaceInfo> interfaces;  ///< Interfaces listed in /proc/net/dev
+    double rxRate = 0.0;                      ///< Received bytes per second, all interfaces but lo
+    double txRate = 0.0;                      ///< Transmitted bytes per second, all interfaces but lo
+    bool sampled = false;                     ///< False in the empty section of a suspended or not yet run collector
+};
+
+/**
+ * @brief Minimum, average and maximum of the samples seen in one render interval.
+ */
+struct BurstStats {
+    double min = 0.0;
+    double avg = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * @brief Summary of the high-frequency samples taken since the previous frame.
+ */
+struct HzSnapshot {
+    int hz = 0;             ///< Sampling rate, 0 when high-frequency mode is off
+    bool cpu = false;       ///< CPU usage is being sampled
+    bool network = false;   ///< Network rates are being sampled
+    size_t samples = 0;     ///< Samples summarised in this interval
+    size_t dropped = 0;     ///< Samples lost because the ring buffer was full
+    BurstStats cpuUsage;    ///< CPU usage percentage
+    BurstStats rxRate;      ///< Received bytes per second, all interfaces but lo
+    BurstStats txRate;      ///< Transmitted bytes per second, all interfaces but lo
+};
+
+/**
+ * @brief Complete set of statistics handed to the renderers.
+ *
+ * Each section is filled by its own collector and handed to renderers by
+ * const reference, so collection and presentation can be timed and changed
+ * independently.
+ */
+struct Snapshot {
+    Clock::time_point time;                 ///< Moment the snapshot was assembled
+    MemorySnapshot memory;
+    CPUSnapshot cpu;
+    SensorSnapshot sensors;
+    BatteryInfo battery;
+    SharedList<DiskInfo> disks;
+    DiskIOSnapshot diskIO;
+    NetworkSnapshot network;
+    string wifiSignal;                      ///< "Signal level=..." text from iwconfig, empty if none
+    HzSnapshot burst;                       ///< High-frequency summary, filled by HzSampler
+};
+
+/**
+ * @brief Where the proc and sys filesystems that termistat reads are mounted.
+ *
+ * Defaults to the running system. Other roots let termistat watch a host
+ * from a container through bind mounts such as /host/proc, /host/sys and
+ * /host, or replay a recorded fixture tree.
+ */
+struct SystemPaths {
+    string procRoot = "/proc";
+    string sysRoot = "/sys";
+    string rootfs;          ///< Where the watched system's / is mounted, empty for our own
+
+    /// Path of @p relative under the proc root.
+    string proc(string_view relative) const { return join(procRoot, relative); }
+    /// Path of @p relative under the sys root.
+    string sys(string_view relative) const { return join(sysRoot, relative); }
+
+    /**
+     * @brief Path of a per-namespace file such as mounts or net/dev, as PID 1 of the watched system sees it.
+     *
+     * /proc/mounts and /proc/net/dev link to self/, which is the reader's
+     * own mount and network namespace even under a host's procfs; 1/
+     * under another proc root is the host's. Trees without a 1/ entry,
+     * such as recorded fixtures, are read as they are.
+     */
+    string initProc(string_view relative) const {
+        if (procRoot != "/proc") {
+            string init = proc("1/" + string(relative));
+            if (access(init.c_str(), R_OK) == 0)
+                return init;
+        }
+        return proc(relative);
+    }
+
+private:
+    static string join(const string& root, string_view relative) {
+        string path;
+        path.reserve(root.size() + 1 + relative.size());
+        path += root;
+        path += '/';
+        path += relative;
+        return path;
+    }
+};
+
+/**
+ * @brief Reads total and available memory from /proc/meminfo.
+ *
+ * @param path Location of the meminfo file.
+ * @return MemorySnapshot with both values in KiB.
+ */
+MemorySnapshot collectMemory(const char* path) {
+    MemorySnapshot mem;
+    ifstream meminfo(path);
+    string line;
+
+    while (getline(meminfo, line)) {
+        if (line.find("MemTotal:") == 0)
+            mem.totalKB = stol(line.substr(9));
+        if (line.find("MemAvailable:") == 0)
+            mem.availableKB = stol(line.substr(13));
+    }
+    return mem;
+}
+
+/**
+ * @brief Reads CPU temperature from sysfs.
+ *
+ * @return CPU temperature in degrees Celsius or -1.0 if unavailable.
+ */
+float readCPUTemperature(const SystemPaths& paths) {
+    ScopedTimer timer("readCPUTemperature", "sensor"); // counted in the hwmon collector
+    ifstream file(paths.sys("class/thermal/thermal_zone0/temp"));
+    if (!file.is_open()) return -1.0f;
+
+    int tempMilliC;
+    file >> tempMilliC;
+    return tempMilliC / 1000.0f;  // Convert millidegrees to degrees Celsius
+}
+
+/**
+ * @brief Attempts to read CPU fan RPM from available hwmon devices.
+ *
+ * Iterates over /sys/class/hwmon to find fan input files.
+ *
+ * @return Fan speed in RPM, or -1 if not available.
+ */
+int readFanRPM(const SystemPaths& paths) {
+    ScopedTimer timer("readFanRPM", "sensor"); // counted in the hwmon collector
+    const string basePath = paths.sys("class/hwmon/");
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(basePath, ec)) {
+        string namePath = entry.path().string() + "/name";
+        ifstream nameFile(namePath);
+        if (!nameFile.is_open()) continue;
+
+        string chipName;
+        getline(nameFile, chipName);
+
+        // Optional: filter chipName if needed (e.g., == "nct6775")
+
+        for (int i = 1; i <= 5; ++i) {
+            string fanPath = entry.path().string() + "/fan" + to_string(i) + "_input";
+            ifstream fanFile(fanPath);
+            if (fanFile.is_open()) {
+                int rpm;
+                fanFile >> rpm;
+                if (rpm > 0)
+                    return rpm;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reads temperature and fan speed.
+ *
+ * @return SensorSnapshot with -1 for every unavailable reading.
+ */
+SensorSnapshot collectSensors(const SystemPaths& paths) {
+    return { readCPUTemperature(paths), readFanRPM(paths) };
+}
+
+/**
+ * @brief Procfs file kept open and re-read with pread().
+ *
+ * Avoids the open/close and stream setup of ifstream for files that are
+ * sampled many times per second. The returned views point into an internal
+ * buffer and stay valid until the next read.
+ */
+class ProcFile {
+public:
+    explicit ProcFile(const char* path) : fd_(open(path, O_RDONLY | O_CLOEXEC)) {}
+    ~ProcFile() { if (fd_ >= 0) close(fd_); }
+    ProcFile(const ProcFile&) = delete;
+    ProcFile& operator=(const ProcFile&) = delete;
+
+    /**
+     * @brief Reads at most @p limit bytes from the start of the file.
+     */
+    string_view readHead(size_t limit) {
+        if (buffer_.size() < limit) buffer_.resize(limit);
+        ssize_t n = fd_ >= 0 ? pread(fd_, buffer_.data(), limit, 0) : -1;
+        return string_view(buffer_.data(), n > 0 ? n : 0);
+    }
+
+    /**
+     * @brief Reads the whole file, growing the buffer as needed.
+     */
+    string_view readAll() {
+        if (buffer_.empty()) buffer_.resize(4096);
+        size_t used = 0;
+        while (fd_ >= 0) {
+            ssize_t n = pread(fd_, buffer_.data() + used, buffer_.size() - used, used);
+            if (n <= 0) break;
+            used += n;
+            if (used == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+        }
+        return string_view(buffer_.data(), used);
+    }
+
+private:
+    int fd_;
+    vector<char> buffer_;
+};
+
+/**
+ * @brief Parses the next unsigned decimal number, skipping leading blanks.
+ *
+ * @param p Read position, advanced past the number.
+ * @param end End of the input.
+ * @return The parsed value, 0 if no digits were found.
+ */
+unsigned long long parseNumber(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    unsigned long long value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    return value;
+}
+
+/**
+ * @brief Aggregate CPU time counters from one /proc/stat sample.
+ */
+struct CPUCounters {
+    long idle = 0;   ///< Idle plus iowait jiffies
+    long total = 0;  ///< Sum of all accounted jiffies
+};
+
+/**
+ * @brief Reads the aggregate "cpu" line of /proc/stat.
+ */
+CPUCounters readCPUCounters(ProcFile& stat) {
+    string_view text = stat.readHead(256);
+    const char* p = text.data();
+    const char* end = p + text.size();
+    p += min<size_t>(text.size(), 3); // skip "cpu"
+
+    unsigned long long user = parseNumber(p, end);
+    unsigned long long nice = parseNumber(p, end);
+    unsigned long long system = parseNumber(p, end);
+    unsigned long long idle = parseNumber(p, end);
+    unsigned long long iowait = parseNumber(p, end);
+    unsigned long long irq = parseNumber(p, end);
+    unsigned long long softirq = parseNumber(p, end);
+
+    CPUCounters counters;
+    counters.idle = idle + iowait;
+    counters.total = user + nice + system + counters.idle + irq + softirq;
+    return counters;
+}
+
+/**
+ * @brief Usage percentage between two counter samples.
+ */
+float cpuUsage(const CPUCounters& prev, const CPUCounters& cur) {
+    long deltaIdle = cur.idle - prev.idle;
+    long deltaTotal = cur.total - prev.total;
+    if (deltaTotal <= 0)
+        return 0.0f;
+    return 100.0f * (deltaTotal - deltaIdle) / deltaTotal;
+}
+
+/**
+ * @brief Samples CPU usage.
+ *
+ * Parses /proc/stat and computes usage from the delta against the previous sample.
+ *
+ * @param stat Open /proc/stat.
+ * @param prev Counters of the previous sample, updated in place.
+ * @return CPUSnapshot for this collection pass.
+ */
+CPUSnapshot collectCPU(ProcFile& stat, CPUCounters& prev) {
+    CPUCounters cur = readCPUCounters(stat);
+    CPUSnapshot snap;
+    snap.usage = cpuUsage(prev, cur);
+    snap.sampled = true;
+    prev = cur;
+    return snap;
+}
+
+/**
+ * @brief Reads battery capacity and status from sysfs.
+ *
+ * @return BatteryInfo struct with capacity, status, and availability.
+ */
+BatteryInfo readBattery(const SystemPaths& paths) {
+    BatteryInfo info{ -1, "Unknown", false };
+    const std::string batteryPath = paths.sys("class/power_supply/BAT0/");
+
+    ifstream capFile(batteryPath + "capacity");
+    ifstream statusFile(batteryPath + "status");
+
+    if (capFile.is_open() && statusFile.is_open()) {
+        capFile >> info.capacity;
+        getline(statusFile, info.status);
+        info.available = true;
+    }
+
+    return info;
+}
+
+/**
+ * @brief Collects space usage for mounted filesystems excluding system and device mounts.
+ *
+ * @param mountsPath Location of the mount table.
+ * @param rootfs Prefix that makes the table's mount points reachable from here, see SystemPaths::rootfs.
+ * @return One DiskInfo per mount that statvfs could query.
+ */
+vector<DiskInfo> collectDisks(const char* mountsPath, const string& rootfs = {}) {
+    vector<DiskInfo> disks;
+    ifstream mounts(mountsPath);
+    string line;
+
+    while (getline(mounts, line)) {
+        istringstream iss(line);
+        string device, mountpoint;
+        iss >> device >> mountpoint;
+
+        // Skip device and system mounts
+        if (mountpoint.find("/dev") != string::npos || mountpoint.find("/sys") != string::npos)
+            continue;
+
+        struct statvfs stat;
+        if (statvfs((rootfs + mountpoint).c_str(), &stat) == 0) {
+            unsigned long long total = stat.f_blocks * stat.f_frsize;
+            unsigned long long free = stat.f_bfree * stat.f_frsize;
+            disks.push_back({ mountpoint, total, total - free });
+        }
+    }
+    return disks;
+}
+
+/**
+ * @brief Sector counters from the previous /proc/diskstats sample.
+ */
+struct DiskIOCounters {
+    Clock::time_point time;                     ///< When the sample was taken
+    unsigned long long readSectors = 0;
+    unsigned long long writtenSectors = 0;
+    unordered_map<string, bool> wholeDisk;      ///< Cache of /sys/block lookups by device name
+};
+
+/**
+ * @brief Collects read/write throughput of whole disks from /proc/diskstats.
+ *
+ * Partitions are skipped so their I/O is not counted twice, and so are
+ * loop and ram devices.
+ *
+ * @param diskstats Open /proc/diskstats.
+ * @param prev Counters of the previous sample, updated in place.
+ * @param paths Locates /sys/block, which tells whole disks from partitions.
+ */
+DiskIOSnapshot collectDiskIO(ProcFile& diskstats, DiskIOCounters& prev, const SystemPaths& paths) {
+    string_view text = diskstats.readAll();
+    unsigned long long readSectors = 0, writtenSectors = 0;
+
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        size_t eol = text.find('\n', lineStart);
+        if (eol == string_view::npos) eol = text.size();
+        const char* p = text.data() + lineStart;
+        const char* end = text.data() + eol;
+        lineStart = eol + 1;
+
+        parseNumber(p, end); // major
+        parseNumber(p, end); // minor
+        while (p < end && *p == ' ') ++p;
+        const char* nameStart = p;
+        while (p < end && *p != ' ') ++p;
+        string name(nameStart, p);
+        if (name.empty() || name.compare(0, 4, "loop") == 0 || name.compare(0, 3, "ram") == 0)
+            continue;
+
+        auto cached = prev.wholeDisk.find(name);
+        if (cached == prev.wholeDisk.end())
+            cached = prev.wholeDisk.emplace(name, access(paths.sys("block/" + name).c_str(), F_OK) == 0).first;
+        if (!cached->second)
+            continue;
+
+        parseNumber(p, end); // reads completed
+        parseNumber(p, end); // reads merged
+        readSectors += parseNumber(p, end);
+        parseNumber(p, end); // time reading
+        parseNumber(p, end); // writes completed
+        parseNumber(p, end); // writes merged
+        writtenSectors += parseNumber(p, end);
+    }
+
+    DiskIOSnapshot snap;
+    snap.sampled = true;
+    Clock::time_point now = Clock::now();
+    if (prev.time != Clock::time_point{}) {
+        double seconds = chrono::duration<double>(now - prev.time).count();
+        if (seconds > 0) {
+            const double sectorBytes = 512.0; // diskstats always counts 512-byte sectors
+            snap.readRate = (readSectors - min(readSectors, prev.readSectors)) * sectorBytes / seconds;
+            snap.writeRate = (writtenSectors - min(writtenSectors, prev.writtenSectors)) * sectorBytes / seconds;
+        }
+    }
+    prev.time = now;
+    prev.readSectors = readSectors;
+    prev.writtenSectors = writtenSectors;
+    return snap;
+}
+
+/**
+ * @brief Interface counters from the previous /proc/net/dev sample.
+ */
+struct NetCounters {
+    Clock::time_point time;                                     ///< When the sample was taken
+    unordered_map<string, pair<long long, long long>> bytes;    ///< RX/TX bytes by interface name
+};
+
+/**
+ * @brief Collects interface byte counters and rates from /proc/net/dev.
+ *
+ * @param prev Counters of the previous sample, updated in place.
+ * @param path Location of the net/dev file.
+ * @return NetworkSnapshot for this collection pass.
+ */
+NetworkSnapshot collectNetwork(NetCounters& prev, const char* path) {
+    NetworkSnapshot snap;
+    snap.sampled = true;
+    Clock::time_point now = Clock::now();
+    double seconds = prev.time == Clock::time_point{} ? 0.0
+                   : chrono::duration<double>(now - prev.time).count();
+
+    vector<NetInterfaceInfo> interfaces;
+    ifstream net(path);
+    string line;
+    getline(net, line); // skip header
+    getline(net, line); // skip header
+
+    while (getline(net, line)) {
+        istringstream iss(line);
+        string iface;
+        getline(iss, iface, ':');
+        iface.erase(remove(iface.begin(), iface.end(), ' '), iface.end());
+
+        long long rx, tx;
+        iss >> rx;
+        for (int i = 0; i < 8; ++i) iss >> tx; // skip fields to reach tx
+
+        NetInterfaceInfo info{ iface, rx, tx };
+        auto it = prev.bytes.find(iface);
+        if (it != prev.bytes.end() && seconds > 0) {
+            info.rxRate = max(0LL, rx - it->second.first) / seconds;
+            info.txRate = max(0LL, tx - it->second.second) / seconds;
+            if (iface != "lo") {
+                snap.rxRate += info.rxRate;
+                snap.txRate += info.txRate;
+            }
+        }
+        prev.bytes[iface] = { rx, tx };
+        interfaces.push_back(move(info));
+    }
+    snap.interfaces = move(interfaces);
+    prev.time = now;
+    return snap;
+}
+
+/**
+ * @brief Byte counters summed over every interface except loopback.
+ */
+struct NetTotals {
+    unsigned long long rxBytes = 0;
+    unsigned long long txBytes = 0;
+};
+
+/**
+ * @brief Sums RX and TX bytes of all non-loopback interfaces in /proc/net/dev.
+ */
+NetTotals readNetTotals(ProcFile& netDev) {
+    string_view text = netDev.readAll();
+    NetTotals totals;
+    size_t lineStart = 0;
+    for (int skip = 0; skip < 2 && lineStart < text.size(); ++skip) { // skip headers
+        size_t eol = text.find('\n', lineStart);
+        lineStart = eol == string_view::npos ? text.size() : eol + 1;
+    }
+
+    while (lineStart < text.size()) {
+        size_t eol = text.find('\n', lineStart);
+        if (eol == string_view::npos) eol = text.size();
+        string_view line = text.substr(lineStart, eol - lineStart);
+        lineStart = eol + 1;
+
+        size_t colon = line.find(':');
+        if (colon == string_view::npos) continue;
+        string_view name = line.substr(0, colon);
+        name.remove_prefix(min(name.find_first_not_of(' '), name.size()));
+        if (name == "lo") continue;
+
+        const char* p = line.data() + colon + 1;
+        const char* end = line.data() + line.size();
+        totals.rxBytes += parseNumber(p, end);
+        for (int i = 0; i < 7; ++i) parseNumber(p, end); // skip fields to reach tx
+        totals.txBytes += parseNumber(p, end);
+    }
+    return totals;
+}
+
+/**
+ * @brief Retrieves the WiFi signal level from iwconfig output.
+ *
+ * @return "Signal level=..." text, or an empty string if no wireless interface reports one.
+ */
+string collectWifiSignal() {
+    string signal;
+    FILE* fp = popen("iwconfig 2>/dev/null", "r");
+    if (fp) {
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), fp)) {
+            string s(buffer);
+            size_t pos = s.find("Signal level=");
+            if (pos != string::npos)
+                signal = s.substr(pos);
+        }
+        pclose(fp);
+    }
+    return signal;
+}
+
+/**
+ * @brief Single-writer, single-reader triple buffer.
+ *
+ * The writer fills its private slot and swaps it with the shared middle
+ * slot; the reader swaps its private slot with the middle one only when a
+ * fresh value is waiting. Neither side ever blocks, and the reader always
+ * sees a complete value.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /// Slot the writer may fill before calling publish().
+    T& writeBuffer() { return buffers_[writeIndex_]; }
+
+    /// Makes the write slot visible to the reader.
+    void publish() {
+        uint8_t prev = middle_.exchange(writeIndex_ | Fresh, memory_order_acq_rel);
+        writeIndex_ = prev & IndexMask;
+    }
+
+    /// Latest published value; stays valid until the next read().
+    const T& read() {
+        if (middle_.load(memory_order_relaxed) & Fresh) {
+            uint8_t prev = middle_.exchange(readIndex_, memory_order_acq_rel);
+            readIndex_ = prev & IndexMask;
+        }
+        return buffers_[readIndex_];
+    }
+
+private:
+    static constexpr uint8_t IndexMask = 3;
+    static constexpr uint8_t Fresh = 4;
+
+    array<T, 3> buffers_{};
+    uint8_t writeIndex_ = 0;
+    uint8_t readIndex_ = 1;
+    atomic<uint8_t> middle_{2};
+};
+
+/**
+ * @brief Interface implemented by every statistics source.
+ *
+ * A collector samples its source in collect() and keeps the result until
+ * store() copies it into a Snapshot. Each collector declares how often it
+ * needs to be sampled, so cheap or fast-changing sources can run more often
+ * than expensive or slow-changing ones.
+ *
+ * Delta collectors report rates against their previous sample. After
+ * startup or a suspension their first collect() only sets that baseline,
+ * so the first published value covers a short, recent interval instead of
+ * the time since boot or since the pause.
+ */
+class Collector {
+public:
+    Collector(const char* name, chrono::milliseconds interval, bool deltas)
+        : name_(name), interval_(interval), deltas_(deltas) {}
+    virtual ~Collector() = default;
+
+    const char* name() const { return name_; }
+    chrono::milliseconds interval() const { return interval_; }
+    bool deltas() const { return deltas_; }
+
+    /// Samples the source and publishes the result. Called from a worker thread.
+    virtual void collect() = 0;
+    /// Copies the latest published result into its section of the snapshot.
+    virtual void store(Snapshot& snap) = 0;
+    /// Drops the published result when sampling stops, so it is not shown stale later.
+    virtual void suspend() = 0;
+
+    /// Set while a worker is running collect(), so a slow source is never queued twice.
+    atomic<bool> busy{false};
+    /// Cleared while nothing needs this source; the scheduler then skips it.
+    atomic<bool> enabled{true};
+    /// The next collect() only sets the baseline of a delta collector.
+    atomic<bool> priming{false};
+    /// Time spent in collect().
+    CostCounter cost;
+
+private:
+    const char* name_;
+    chrono::milliseconds interval_;
+    bool deltas_;
+};
+
+/**
+ * @brief Collector that fills one Snapshot section from a sampling function.
+ *
+ * @tparam T Section type.
+ * @tparam Section Pointer to the Snapshot member this collector owns.
+ */
+template <typename T, T Snapshot::*Section>
+class SectionCollector : public Collector {
+public:
+    SectionCollector(const char* name, chrono::milliseconds interval, function<T()> sampler, bool deltas = false)
+        : Collector(name, interval, deltas), sampler_(move(sampler)) {}
+
+    void collect() override {
+        T value = sampler_();
+        if (priming.exchange(false, memory_order_relaxed))
+            return; // measured against a stale or missing baseline
+        latest_.writeBuffer() = move(value);
+        latest_.publish();
+        published_.store(true, memory_order_release);
+    }
+    /// Until a result is available the section stays empty rather than stale.
+    void store(Snapshot& snap) override {
+        bool current = enabled.load(memory_order_relaxed) && published_.load(memory_order_acquire);
+        snap.*Section = current ? latest_.read() : T{};
+    }
+    void suspend() override { published_.store(false, memory_order_relaxed); }
+
+private:
+    function<T()> sampler_;
+    TripleBuffer<T> latest_;
+    atomic<bool> published_{false};
+};
+
+/**
+ * @brief Owns the collectors and assembles snapshots from their latest results.
+ */
+class CollectorRegistry {
+public:
+    /**
+     * @brief Registers a collector.
+     *
+     * @return Index of the collector inside the registry.
+     */
+    size_t add(unique_ptr<Collector> collector) {
+        collectors_.push_back(move(collector));
+        return collectors_.size() - 1;
+    }
+
+    size_t size() const { return collectors_.size(); }
+    Collector& operator[](size_t index) { return *collectors_[index]; }
+    const Collector& operator[](size_t index) const { return *collectors_[index]; }
+
+    /**
+     * @brief Index of the collector called @p name, or size() if there is none.
+     */
+    size_t find(string_view name) const {
+        for (size_t i = 0; i < collectors_.size(); ++i)
+            if (name == collectors_[i]->name())
+                return i;
+        return collectors_.size();
+    }
+
+    /**
+     * @brief Builds a snapshot from the latest result of every collector.
+     */
+    Snapshot assemble() {
+        Snapshot snap;
+        snap.time = Clock::now();
+        for (auto& collector : collectors_)
+            collector->store(snap);
+        return snap;
+    }
+
+private:
+    vector<unique_ptr<Collector>> collectors_;
+};
+
+/**
+ * @brief Registers the built-in collectors with their sampling intervals.
+ */
+void registerDefaultCollectors(CollectorRegistry& registry, const SystemPaths& paths) {
+    using namespace std::chrono_literals;
+    registry.add(make_unique<SectionCollector<MemorySnapshot, &Snapshot::memory>>(
+        "memory", 1s, [path = paths.proc("meminfo")] { return collectMemory(path.c_str()); }));
+    registry.add(make_unique<SectionCollector<CPUSnapshot, &Snapshot::cpu>>(
+        "cpu", 250ms, [stat = make_shared<ProcFile>(paths.proc("stat").c_str()), prev = CPUCounters{}]() mutable {
+            return collectCPU(*stat, prev);
+        }, true));
+    registry.add(make_unique<SectionCollector<SensorSnapshot, &Snapshot::sensors>>(
+        "hwmon", 5s, [paths] { return collectSensors(paths); }));
+    registry.add(make_unique<SectionCollector<BatteryInfo, &Snapshot::battery>>(
+        "battery", 5s, [paths] { return readBattery(paths); }));
+    registry.add(make_unique<SectionCollector<SharedList<DiskInfo>, &Snapshot::disks>>(
+        "disk", 30s, [path = paths.initProc("mounts"), rootfs = paths.rootfs] {
+            return collectDisks(path.c_str(), rootfs);
+        }));
+    registry.add(make_unique<SectionCollector<DiskIOSnapshot, &Snapshot::diskIO>>(
+        "diskio", 1s, [stats = make_shared<ProcFile>(paths.proc("diskstats").c_str()),
+                       prev = make_shared<DiskIOCounters>(), paths] {
+            return collectDiskIO(*stats, *prev, paths);
+        }, true));
+    registry.add(make_unique<SectionCollector<NetworkSnapshot, &Snapshot::network>>(
+        "network", 1s, [prev = make_shared<NetCounters>(), path = paths.initProc("net/dev")] {
+            return collectNetwork(*prev, path.c_str());
+        }, true));
+    registry.add(make_unique<SectionCollector<string, &Snapshot::wifiSignal>>(
+        "wifi", 5s, collectWifiSignal));
+}
+
+/**
+ * @brief Hashed timer wheel keyed by collector index.
+ *
+ * Time is divided into fixed ticks; a timer lives in the slot of its
+ * deadline tick modulo the wheel size and fires once the wheel passes
+ * that tick. Deadlines further away than one revolution simply stay in
+ * their slot until the right round comes up.
+ */
+class TimerWheel {
+public:
+    static constexpr chrono::milliseconds Tick{10};
+    static constexpr size_t Slots = 256;
+
+    explicit TimerWheel(Clock::time_point start) : start_(start) {}
+
+    /**
+     * @brief Arms the timer for @p id at @p deadline, replacing an earlier deadline.
+     */
+    void schedule(size_t id, Clock::time_point deadline) {
+        uint64_t tick = max(toTick(deadline), current_ + 1);
+        if (id >= deadlines_.size())
+            deadlines_.resize(id + 1, Disarmed);
+        if (deadlines_[id] != Disarmed) {
+            vector<size_t>& slot = slots_[deadlines_[id] % Slots];
+            slot.erase(find(slot.begin(), slot.end(), id));
+        }
+        deadlines_[id] = tick;
+        slots_[tick % Slots].push_back(id);
+    }
+
+    /**
+     * @brief Advances the wheel to @p now and calls @p fire for every expired timer.
+     *
+     * Fired timers are disarmed; the callback re-arms them if needed.
+     */
+    void advance(Clock::time_point now, const function<void(size_t)>& fire) {
+        uint64_t target = toTick(now);
+        // After a long stall there is no point walking more than one revolution
+        uint64_t from = target - current_ > Slots ? target - Slots : current_;
+        for (uint64_t tick = from + 1; tick <= target; ++tick) {
+            vector<size_t>& slot = slots_[tick % Slots];
+            for (size_t i = 0; i < slot.size();) {
+                size_t id = slot[i];
+                if (deadlines_[id] <= target) {
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                    deadlines_[id] = Disarmed;
+                    fire(id);
+                } else {
+                    ++i;
+                }
+            }
+        }
+        current_ = max(current_, target);
+    }
+
+    /**
+     * @brief Time of the earliest armed deadline, or @p fallback if none is armed.
+     */
+    Clock::time_point nextDeadline(Clock::time_point fallback) const {
+        uint64_t earliest = UINT64_MAX;
+        for (const vector<size_t>& slot : slots_)
+            for (size_t id : slot)
+                earliest = min(earliest, deadlines_[id]);
+        if (earliest == UINT64_MAX)
+            return fallback;
+        return start_ + Tick * earliest;
+    }
+
+private:
+    static constexpr uint64_t Disarmed = 0; ///< Armed ticks are always past tick 0
+
+    uint64_t toTick(Clock::time_point t) const {
+        if (t <= start_) return 0;
+        return chrono::duration_cast<chrono::milliseconds>(t - start_) / Tick;
+    }
+
+    Clock::time_point start_;
+    uint64_t current_ = 0;
+    vector<uint64_t> deadlines_;
+    array<vector<size_t>, Slots> slots_;
+};
+
+/**
+ * @brief Fixed set of worker threads draining a FIFO of tasks.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (thread& worker : workers_)
+            worker.join();
+    }
+
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            tasks_.push_back(move(task));
+        }
+        wake_.notify_one();
+    }
+
+private:
+    void work() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_) return;
+                task = move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    vector<thread> workers_;
+    deque<function<void()>> tasks_;
+    mutex mutex_;
+    condition_variable wake_;
+    bool stopping_ = false;
+};
+
+/**
+ * @brief Runs each registered collector at its own interval on a thread pool.
+ *
+ * A dedicated thread advances the timer wheel and hands due collectors to
+ * the pool. Results reach the renderer through each collector's triple
+ * buffer, so a slow source only delays its own section. A delta collector
+ * that has just (re)started runs again after PrimeDelay, right after its
+ * baseline sample.
+ */
+class CollectorScheduler {
+public:
+    static constexpr size_t MaxWorkers = 4;
+    static constexpr chrono::milliseconds PrimeDelay{100};
+
+    explicit CollectorScheduler(CollectorRegistry& registry)
+        : registry_(registry), wheel_(Clock::now()),
+          pool_(min(registry.size(), MaxWorkers)) {
+        Clock::time_point now = Clock::now();
+        for (size_t id = 0; id < registry_.size(); ++id) {
+            registry_[id].priming.store(registry_[id].deltas(), memory_order_relaxed);
+            fire(id, now);
+        }
+        thread_ = thread([this] { run(); });
+    }
+
+    ~CollectorScheduler() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    /**
+     * @brief Starts or stops sampling one collector.
+     *
+     * A disabled collector is neither dispatched nor re-armed, and its last
+     * result is dropped. Enabling it samples it right away rather than at
+     * its next regular deadline.
+     */
+    void setEnabled(size_t id, bool enabled) {
+        Collector& collector = registry_[id];
+        if (collector.enabled.exchange(enabled, memory_order_relaxed) == enabled)
+            return;
+        if (!enabled) {
+            collector.suspend();
+            return;
+        }
+        collector.priming.store(collector.deltas(), memory_order_relaxed);
+        {
+            lock_guard<mutex> lock(mutex_);
+            wheel_.schedule(id, Clock::now());
+        }
+        wake_.notify_all();
+    }
+
+private:
+    void run() {
+        unique_lock<mutex> lock(mutex_);
+        while (!stopping_) {
+            Clock::time_point now = Clock::now();
+            wheel_.advance(now, [&](size_t id) {
+                if (registry_[id].enabled.load(memory_order_relaxed))
+                    fire(id, now);
+            });
+            wake_.wait_until(lock, wheel_.nextDeadline(now + chrono::seconds(1)));
+        }
+    }
+
+    /// Dispatches a due collector and arms its next deadline.
+    void fire(size_t id, Clock::time_point now) {
+        Collector& collector = registry_[id];
+        bool priming = collector.priming.load(memory_order_relaxed);
+        dispatch(id);
+        wheel_.schedule(id, now + (priming ? PrimeDelay : collector.interval()));
+    }
+
+    void dispatch(size_t id) {
+        Collector& collector = registry_[id];
+        if (collector.busy.exchange(true, memory_order_acquire))
+            return; // previous run still in flight
+        pool_.submit([&collector] {
+            {
+                ScopedTimer timer(collector.cost, collector.name(), "collector");
+                collector.collect();
+            }
+            collector.busy.store(false, memory_order_release);
+        });
+    }
+
+    CollectorRegistry& registry_;
+    TimerWheel wheel_;
+    ThreadPool pool_;
+    thread thread_;
+    mutex mutex_;
+    condition_variable wake_;
+    bool stopping_ = false;
+};
+
+/**
+ * @brief Fixed-capacity single-producer, single-consumer ring buffer.
+ *
+ * Storage is allocated once; push() and pop() are wait-free. When the
+ * consumer falls behind, push() fails instead of overwriting.
+ *
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SampleRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T& value) {
+        size_t head = head_.load(memory_order_relaxed);
+        if (head - tail_.load(memory_order_acquire) == Capacity)
+            return false;
+        slots_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t tail = tail_.load(memory_order_relaxed);
+        if (tail == head_.load(memory_order_acquire))
+            return false;
+        value = slots_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    array<T, Capacity> slots_{};
+    alignas(64) atomic<size_t> head_{0};
+    alignas(64) atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief Accumulates min/avg/max over a stream of values.
+ */
+struct RunningStats {
+    double min = INFINITY;
+    double max = -INFINITY;
+    double sum = 0.0;
+    size_t count = 0;
+
+    void add(double value) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        ++count;
+    }
+
+    BurstStats result() const {
+        if (count == 0) return {};
+        return { min, sum / count, max };
+    }
+};
+
+/**
+ * @brief Samples CPU usage and network rates at up to 100 Hz on its own thread.
+ *
+ * Samples go into a preallocated ring buffer; the renderer drains it once
+ * per frame and keeps only min/avg/max, so short bursts that the regular
+ * collectors average away stay visible.
+ */
+class HzSampler {
+public:
+    static constexpr int MaxHz = 100;
+
+    HzSampler(int hz, bool cpu, bool network, const SystemPaths& paths)
+        : hz_(hz), cpu_(cpu), network_(network), paths_(paths), thread_([this] { run(); }) {}
+
+    ~HzSampler() {
+        stopping_.store(true, memory_order_relaxed);
+        thread_.join();
+    }
+
+    /**
+     * @brief Suspends or resumes the configured metrics, e.g. while their panel is hidden.
+     */
+    void setEnabled(bool cpu, bool network) {
+        cpuEnabled_.store(cpu, memory_order_relaxed);
+        networkEnabled_.store(network, memory_order_relaxed);
+    }
+
+    /**
+     * @brief Drains the samples taken since the previous call into @p out.
+     */
+    void summarize(HzSnapshot& out) {
+        RunningStats cpuUsage, rxRate, txRate;
+        Sample sample;
+        while (ring_.pop(sample)) {
+            cpuUsage.add(sample.cpuUsage);
+            rxRate.add(sample.rxRate);
+            txRate.add(sample.txRate);
+        }
+        out.hz = hz_;
+        out.cpu = cpu_ && cpuEnabled_.load(memory_order_relaxed);
+        out.network = network_ && networkEnabled_.load(memory_order_relaxed);
+        out.samples = cpuUsage.count;
+        out.dropped = dropped_.exchange(0, memory_order_relaxed);
+        out.cpuUsage = cpuUsage.result();
+        out.rxRate = rxRate.result();
+        out.txRate = txRate.result();
+    }
+
+    /**
+     * @brief Drops the samples taken so far, e.g. while the view is paused.
+     *
+     * Keeps the ring from filling up and counting drops, and keeps samples
+     * from before a pause out of the first summary after it.
+     */
+    void discard() {
+        Sample sample;
+        while (ring_.pop(sample)) {}
+        dropped_.store(0, memory_order_relaxed);
+    }
+
+private:
+    struct Sample {
+        float cpuUsage;
+        double rxRate;
+        double txRate;
+    };
+
+    void run() {
+        ProcFile stat(paths_.proc("stat").c_str());
+        ProcFile netDev(paths_.initProc("net/dev").c_str());
+        const auto period = chrono::microseconds(1000000 / hz_);
+
+        CPUCounters prevCPU;
+        NetTotals prevNet;
+        bool primedCPU = false, primedNet = false; // previous counters are recent
+        Clock::time_point prevTime = Clock::now();
+        Clock::time_point deadline = prevTime + period;
+
+        while (!stopping_.load(memory_order_relaxed)) {
+            this_thread::sleep_until(deadline);
+            deadline += period;
+
+            Clock::time_point now = Clock::now();
+            double seconds = chrono::duration<double>(now - prevTime).count();
+            prevTime = now;
+
+            bool sampleCPU = cpu_ && cpuEnabled_.load(memory_order_relaxed);
+            bool sampleNet = network_ && networkEnabled_.load(memory_order_relaxed);
+            Sample sample{};
+            bool complete = true;
+            if (sampleCPU) {
+                CPUCounters cur = readCPUCounters(stat);
+                sample.cpuUsage = cpuUsage(prevCPU, cur);
+                complete = complete && primedCPU;
+                prevCPU = cur;
+            }
+            if (sampleNet && seconds > 0) {
+                NetTotals cur = readNetTotals(netDev);
+                // Totals drop when an interface goes away or a counter resets
+                sample.rxRate = (cur.rxBytes > prevNet.rxBytes ? cur.rxBytes - prevNet.rxBytes : 0) / seconds;
+                sample.txRate = (cur.txBytes > prevNet.txBytes ? cur.txBytes - prevNet.txBytes : 0) / seconds;
+                complete = complete && primedNet;
+                prevNet = cur;
+            }
+            primedCPU = sampleCPU;
+            primedNet = sampleNet;
+            // The first sample after (re)starting only primes the counters
+            if ((sampleCPU || sampleNet) && complete && !ring_.push(sample))
+                dropped_.fetch_add(1, memory_order_relaxed);
+
+            if (deadline < now) // fell behind, do not try to catch up
+                deadline = now + period;
+        }
+    }
+
+    int hz_;
+    bool cpu_;
+    bool network_;
+    SystemPaths paths_;
+    atomic<bool> cpuEnabled_{true};
+    atomic<bool> networkEnabled_{true};
+    SampleRing<Sample, 1024> ring_;
+    atomic<size_t> dropped_{0};
+    atomic<bool> stopping_{false};
+    thread thread_;
+};
+
+/**
+ * @brief One aggregated history bucket.
+ */
+struct HistoryPoint {
+    float min;
+    float max;
+    float avg;
+    float last;
+};
+
+/**
+ * @brief Resolution and length of one history tier.
+ */
+struct HistoryTier {
+    int resolution;     ///< Bucket width in seconds
+    size_t capacity;    ///< Number of buckets kept
+};
+
+/// 1 s for 10 min, 10 s for 6 h, 1 min for 7 days.
+constexpr array<HistoryTier, 3> HistoryTiers = {{ { 1, 600 }, { 10, 2160 }, { 60, 10080 } }};
+
+/**
+ * @brief Fixed-size multi-resolution time series of one metric.
+ *
+ * Every tier is a ring of HistoryPoint inside memory owned by MetricHistory.
+ * Values are aggregated into the open bucket of the finest tier; when a
+ * bucket closes its aggregate is stored and fed into the next coarser
+ * tier, so rollups cost O(tiers) per insert and never rescan old data.
+ * Seconds without samples leave no bucket behind.
+ */
+class MetricSeries {
+public:
+    /**
+     * @brief Attaches the series to its slice of the arena.
+     */
+    void attach(HistoryPoint* storage) {
+        for (size_t tier = 0; tier < HistoryTiers.size(); ++tier) {
+            tiers_[tier].points = storage;
+            storage += HistoryTiers[tier].capacity;
+        }
+    }
+
+    /**
+     * @brief Adds a sample taken @p second seconds after history start.
+     */
+    void add(int64_t second, float value) {
+        feed(0, second, Bucket{ second, value, value, value, 1, value });
+    }
+
+    /**
+     * @brief Number of closed buckets held by @p tier.
+     */
+    size_t size(size_t tier) const { return tiers_[tier].count; }
+
+    /**
+     * @brief Closed bucket @p age steps back in @p tier, 0 being the newest.
+     */
+    const HistoryPoint& at(size_t tier, size_t age) const {
+        const Ring& ring = tiers_[tier];
+        size_t capacity = HistoryTiers[tier].capacity;
+        return ring.points[(ring.head + capacity - 1 - age) % capacity];
+    }
+
+    /**
+     * @brief Copies the newest @p n values of @p tier, oldest first.
+     *
+     * @return Number of values written to @p out.
+     */
+    size_t recent(size_t tier, size_t n, float* out, float HistoryPoint::*field = &HistoryPoint::avg) const {
+        n = min(n, size(tier));
+        for (size_t i = 0; i < n; ++i)
+            out[i] = at(tier, n - 1 - i).*field;
+        return n;
+    }
+
+private:
+    struct Bucket {
+        int64_t start;  ///< Start of the bucket in seconds since history start
+        float min;
+        float max;
+        double sum;
+        uint32_t count;
+        float last;
+    };
+
+    struct Ring {
+        HistoryPoint* points = nullptr;
+        size_t head = 0;
+        size_t count = 0;
+        Bucket open{ -1, 0, 0, 0, 0, 0 };
+    };
+
+    void feed(size_t tier, int64_t second, const Bucket& sample) {
+        Ring& ring = tiers_[tier];
+        int64_t start = second - second % HistoryTiers[tier].resolution;
+        if (ring.open.count > 0 && ring.open.start != start)
+            close(tier);
+        if (ring.open.count == 0) {
+            ring.open = sample;
+            ring.open.start = start;
+            return;
+        }
+        ring.open.min = std::min(ring.open.min, sample.min);
+        ring.open.max = std::max(ring.open.max, sample.max);
+        ring.open.sum += sample.sum;
+        ring.open.count += sample.count;
+        ring.open.last = sample.last;
+    }
+
+    void close(size_t tier) {
+        Ring& ring = tiers_[tier];
+        const Bucket& b = ring.open;
+        size_t capacity = HistoryTiers[tier].capacity;
+        ring.points[ring.head] = { b.min, b.max, float(b.sum / b.count), b.last };
+        ring.head = (ring.head + 1) % capacity;
+        ring.count = std::min(ring.count + 1, capacity);
+        if (tier + 1 < HistoryTiers.size())
+            feed(tier + 1, b.start, b);
+        ring.open.count = 0;
+    }
+
+    array<Ring, HistoryTiers.size()> tiers_;
+};
+
+/**
+ * @brief Bounded history of every graphed metric, stored in one arena.
+ */
+class MetricHistory {
+public:
+    enum Metric { CPU, Memory, NetRx, NetTx, DiskRead, DiskWrite, MetricCount };
+
+    static constexpr size_t pointsPerSeries() {
+        size_t total = 0;
+        for (const HistoryTier& tier : HistoryTiers)
+            total += tier.capacity;
+        return total;
+    }
+
+    explicit MetricHistory(Clock::time_point start)
+        : start_(start), arena_(new HistoryPoint[MetricCount * pointsPerSeries()]) {
+        for (size_t m = 0; m < MetricCount; ++m)
+            series_[m].attach(arena_.get() + m * pointsPerSeries());
+    }
+
+    /**
+     * @brief Records the current value of @p metric.
+     */
+    void record(Metric metric, Clock::time_point time, float value) {
+        int64_t second = chrono::duration_cast<chrono::seconds>(time - start_).count();
+        series_[metric].add(second, value);
+    }
+
+    /**
+     * @brief Records every metric from a snapshot.
+     *
+     * Sections without a sample are skipped, so a suspended collector leaves
+     * a gap in its graphs rather than a false drop to 0.
+     */
+    void record(const Snapshot& snap) {
+        const MemorySnapshot& mem = snap.memory;
+        if (snap.cpu.sampled)
+            record(CPU, snap.time, snap.cpu.usage);
+        if (mem.totalKB > 0)
+            record(Memory, snap.time, 100.0f * (mem.totalKB - mem.availableKB) / mem.totalKB);
+        if (snap.network.sampled) {
+            record(NetRx, snap.time, snap.network.rxRate);
+            record(NetTx, snap.time, snap.network.txRate);
+        }
+        if (snap.diskIO.sampled) {
+            record(DiskRead, snap.time, snap.diskIO.readRate);
+            record(DiskWrite, snap.time, snap.diskIO.writeRate);
+        }
+    }
+
+    const MetricSeries& series(Metric metric) const { return series_[metric]; }
+
+    /**
+     * @brief Bytes held by the arena and the per-series bookkeeping.
+     */
+    size_t memoryBytes() const {
+        return MetricCount * pointsPerSeries() * sizeof(HistoryPoint) + sizeof(*this);
+    }
+
+private:
+    Clock::time_point start_;
+    unique_ptr<HistoryPoint[]> arena_;
+    array<MetricSeries, MetricCount> series_;
+};
+
+/**
+ * @brief Panels in display order.
+ */
+enum PanelId { MemoryPanel, CPUPanel, BatteryPanel, DisksPanel, NetworkPanel, PanelCount };
+
+/// Panel names used in timings and traces.
+constexpr array<const char*, PanelCount> PanelNames = { "memory", "cpu", "battery", "disks", "network" };
+
+/// Collectors feeding each panel; hiding the panel stops them.
+constexpr array<array<const char*, 2>, PanelCount> PanelCollectors = {{
+    { "memory", nullptr },
+    { "cpu", "hwmon" },
+    { "battery", nullptr },
+    { "disk", "diskio" },
+    { "network", "wifi" },
+}};
+
+/**
+ * @brief Order of the disk and interface lists.
+ */
+enum class SortKey {
+    Natural,    ///< As listed by the kernel
+    Name,       ///< Mount point or interface name
+    Usage,      ///< Fullest filesystem or busiest interface first
+    Count
+};
+
+/**
+ * @brief Scroll position and selection of a list panel.
+ */
+struct ListCursor {
+    size_t top = 0;         ///< First entry shown
+    size_t selected = 0;    ///< Selected entry
+};
+
+/**
+ * @brief Where a list was drawn in the last frame.
+ */
+struct ListArea {
+    Rect rows;              ///< Screen cells of the list rows
+    size_t count = 0;       ///< Entries in the list
+    size_t top = 0;         ///< Entry drawn in the first row
+};
+
+/**
+ * @brief Presentation choices shared by all renderers.
+ */
+struct ViewSettings {
+    TerminalCaps caps;              ///< Detected terminal capabilities
+    bool brailleGraphs = false;     ///< Draw history as Braille line graphs instead of sparklines
+    bool selfStats = false;         ///< Overlay termistat's own cost
+    int barWidth = 40;              ///< Progress bar width in cells
+    int graphWidth = 40;            ///< Graph width in cells
+    int graphHeight = 2;            ///< Braille graph height in rows
+    array<bool, PanelCount> panels = { true, true, true, true, true };  ///< Visible panels
+    SortKey sort = SortKey::Natural;    ///< Order of the disk and interface lists
+    bool sortReversed = false;          ///< Reverse the chosen order
+    string filter;                      ///< Only list disks and interfaces whose name contains this
+    array<ListCursor, PanelCount> lists{};  ///< Scroll state of the list panels
+    PanelId focus = DisksPanel;             ///< List panel that receives arrow keys
+
+    /// Rows taken by one history graph.
+    int graphRows() const { return brailleGraphs && caps.unicode ? graphHeight : 1; }
+};
+
+/**
+ * @brief Draws the 1-second history of a metric as a labelled sparkline or Braille graph.
+ *
+ * The whole tier is downsampled to the graph width, so the graph covers
+ * up to ten minutes.
+ *
+ * @param label Text printed before the graph; following Braille rows are indented to match.
+ * @param scale Value drawn as full height, or 0 to scale to the visible maximum.
+ */
+void drawGraph(Panel& panel, const string& label, const MetricSeries& series, float scale,
+               const ViewSettings& view) {
+    static vector<float> values;
+    static string graph;
+    size_t capacity = HistoryTiers[0].capacity;
+    values.resize(capacity);
+    size_t n = series.recent(0, capacity, values.data(), &HistoryPoint::max);
+
+    if (scale <= 0)
+        scale = n > 0 ? max(1.0f, *max_element(values.begin(), values.begin() + n)) : 1.0f;
+
+    int width = max(1, min(view.graphWidth, panel.width() - int(label.size())));
+    graph.clear();
+    if (view.brailleGraphs && view.caps.unicode)
+        appendBrailleGraph(graph, values.data(), n, width, view.graphHeight, scale, "");
+    else
+        appendSparkline(graph, values.data(), n, width, scale, view.caps.unicode);
+
+    string_view rows = graph;
+    for (bool first = true; ; first = false) {
+        size_t eol = rows.find('\n');
+        if (!panel.newLine()) return;
+        panel.text(first ? label : string(label.size(), ' '));
+        panel.text(rows.substr(0, eol));
+        if (eol == string_view::npos) break;
+        rows.remove_prefix(eol + 1);
+    }
+}
+
+/**
+ * @brief Filtered, sorted view of a SharedList that only orders what is displayed.
+ *
+ * Without a filter or sort key the view reads the collector's array
+ * directly. A filter costs one pass over the entries. A sort key only
+ * partitions the entries around the visible window and sorts the window
+ * itself, so a frame costs O(n + rows log rows) instead of a full sort and
+ * nothing is formatted outside the viewport.
+ */
+template <typename Entry>
+class ListView {
+public:
+    using Name = const string& (*)(const Entry&);
+    using Less = bool (*)(const Entry&, const Entry&);
+
+    /**
+     * @brief Points the view at @p entries for the next frame.
+     *
+     * @param name Text matched against @p filter.
+     * @param less Sort order, or nullptr for the collection order.
+     */
+    void reset(const SharedList<Entry>& entries, const string& filter, Name name, Less less, bool reversed) {
+        entries_ = entries;
+        less_ = less;
+        reversed_ = reversed;
+        indexed_ = !filter.empty();
+        order_.clear();
+        if (indexed_) {
+            for (size_t i = 0; i < entries_.size(); ++i)
+                if (name(entries_[i]).find(filter) != string::npos)
+                    order_.push_back(uint32_t(i));
+        }
+    }
+
+    size_t size() const { return indexed_ ? order_.size() : entries_.size(); }
+
+    /**
+     * @brief Puts the entries that belong at positions [first, last) there, in order.
+     */
+    void prepare(size_t first, size_t last) {
+        last = min(last, size());
+        if (!less_ || first >= last)
+            return;
+        if (!indexed_) {
+            order_.resize(entries_.size());
+            iota(order_.begin(), order_.end(), 0u);
+            indexed_ = true;
+        }
+        // Ties fall back to the collection order, so equal entries do not swap between frames
+        auto before = [this](uint32_t a, uint32_t b) {
+            if (reversed_) swap(a, b);
+            if (less_(entries_[a], entries_[b])) return true;
+            if (less_(entries_[b], entries_[a])) return false;
+            return a < b;
+        };
+        if (first > 0)
+            nth_element(order_.begin(), order_.begin() + first, order_.end(), before);
+        partial_sort(order_.begin() + first, order_.begin() + last, order_.end(), before);
+    }
+
+    /// Entry at display @p position; positions must have been prepare()d when sorting.
+    const Entry& operator[](size_t position) const {
+        if (!less_ && reversed_)
+            position = size() - 1 - position;
+        return entries_[indexed_ ? order_[position] : position];
+    }
+
+private:
+    SharedList<Entry> entries_;
+    vector<uint32_t> order_;    ///< Entry indices, used once filtered or sorted
+    bool indexed_ = false;
+    Less less_ = nullptr;
+    bool reversed_ = false;
+};
+
+/**
+ * @brief Draws the entries of a list that fit below the current line.
+ *
+ * Drawing starts at the cursor's top entry, pulled back so that the last
+ * page is always full. When not everything fits, the last row shows which
+ * part is visible. The selected entry is highlighted when the list has
+ * focus.
+ *
+ * @param area Receives where the rows went, for mouse hit testing.
+ * @param drawRow Called with each visible entry on a fresh line.
+ */
+template <typename Entry, typename DrawRow>
+void drawList(Panel& panel, ListView<Entry>& entries, const ListCursor& cursor, bool focused,
+              const TerminalCaps& caps, ListArea& area, DrawRow&& drawRow) {
+    size_t count = entries.size();
+    int rows = max(0, panel.rowsLeft());
+    bool scrolled = count > size_t(rows) && rows >= 2;
+    if (scrolled)
+        --rows; // position indicator
+    size_t top = min(cursor.top, count - min(count, size_t(rows)));
+    size_t bottom = min(count, top + rows);
+    area = { { panel.rect().x, panel.rect().y + panel.row() + 1, panel.width(), rows }, count, top };
+
+    entries.prepare(top, bottom);
+    for (size_t i = top; i < bottom && panel.newLine(); ++i) {
+        bool selected = focused && i == cursor.selected;
+        if (selected) {
+            if (caps.color == ColorMode::None)
+                panel.text("> ");
+            panel.style(caps.sgr(SgrSelected));
+        }
+        drawRow(entries[i]);
+        if (selected)
+            panel.style(caps.sgr(SgrReset));
+    }
+    if (scrolled && panel.newLine())
+        panel.print("-- ", formatInt(top + 1), "-", formatInt(bottom), " of ", formatInt(count), " --");
+}
+
+/**
+ * @brief Displays memory usage statistics with a progress bar.
+ */
+void renderMemory(Panel& panel, const MemorySnapshot& mem, const MetricHistory& history, const ViewSettings& view) {
+    long used = mem.totalKB - mem.availableKB;
+    float percent = mem.totalKB > 0 ? 100.0f * used / mem.totalKB : 0.0f;
+
+    drawTitle(panel, "Memory", view.caps);
+    panel.newLine();
+    panel.print("Used: ", formatBytes(used * 1024.0), " / ", formatBytes(mem.totalKB * 1024.0));
+    panel.newLine();
+    drawProgressBar(panel, percent, view.barWidth, false, view.caps);
+    drawGraph(panel, "", history.series(MetricHistory::Memory), 100.0f, view);
+}
+
+/**
+ * @brief Displays CPU usage, temperature, and fan speed with progress bars.
+ */
+void renderCPU(Panel& panel, const CPUSnapshot& cpu, const SensorSnapshot& sensors, const HzSnapshot& burst,
+               const MetricHistory& history, const ViewSettings& view) {
+    drawTitle(panel, "CPU", view.caps);
+    panel.line("Usage: ");
+    drawProgressBar(panel, cpu.usage, view.barWidth, false, view.caps);
+    drawGraph(panel, "       ", history.series(MetricHistory::CPU), 100.0f, view);
+
+    if (burst.hz > 0 && burst.cpu && burst.samples > 0 && panel.newLine())
+        panel.print("Burst: min ", formatPercent(burst.cpuUsage.min), " avg ", formatPercent(burst.cpuUsage.avg),
+                    " max ", formatPercent(burst.cpuUsage.max), " (", formatInt(burst.samples),
+                    " samples @ ", formatInt(burst.hz), " Hz)");
+
+    if (sensors.temperature > 0 && panel.newLine())
+        panel.print("Temp: ", formatFixed(sensors.temperature, 1), " °C");
+
+    if (sensors.fanRPM > 0 && panel.newLine())
+        panel.print("Fan:  ", formatInt(sensors.fanRPM), " RPM");
+}
+
+/**
+ * @brief Displays battery status and charge percentage with an inverted color progress bar.
+ */
+void renderBattery(Panel& panel, const BatteryInfo& bat, const ViewSettings& view) {
+    drawTitle(panel, "Battery", view.caps);
+
+    if (bat.available) {
+        panel.line(bat.status);
+        panel.newLine();
+        drawProgressBar(panel, bat.capacity, view.barWidth, true, view.caps);
+    } else {
+        panel.line("Battery info not available");
+    }
+}
+
+/**
+ * @brief Displays disk I/O and usage for the collected filesystems.
+ */
+void renderDisks(Panel& panel, ListView<DiskInfo>& disks, const DiskIOSnapshot& io,
+                 const MetricHistory& history, const ViewSettings& view, ListArea& area) {
+    drawTitle(panel, "Disks", view.caps);
+
+    if (panel.newLine())
+        panel.print("I/O → Read: ", formatByteRate(io.readRate), ", Write: ", formatByteRate(io.writeRate));
+    drawGraph(panel, "Read:  ", history.series(MetricHistory::DiskRead), 0.0f, view);
+    drawGraph(panel, "Write: ", history.series(MetricHistory::DiskWrite), 0.0f, view);
+
+    drawList(panel, disks, view.lists[DisksPanel], view.focus == DisksPanel, view.caps, area,
+             [&](const DiskInfo& disk) {
+        float percent = disk.totalBytes > 0 ? 100.0f * disk.usedBytes / disk.totalBytes : 0.0f;
+        panel.print(disk.mountpoint, ": ", formatBytes(disk.usedBytes), " / ", formatBytes(disk.totalBytes),
+                    " (", formatPercent(percent), ")");
+    });
+}
+
+/**
+ * @brief Displays network interface RX and TX statistics, including WiFi signal if available.
+ */
+void renderNetwork(Panel& panel, const NetworkSnapshot& net, ListView<NetInterfaceInfo>& interfaces,
+                   const string& wifiSignal, const HzSnapshot& burst, const MetricHistory& history,
+                   const ViewSettings& view, ListArea& area) {
+    drawTitle(panel, "Network", view.caps);
+
+    if (panel.newLine())
+        panel.print("Total → RX: ", formatBitRate(net.rxRate), ", TX: ", formatBitRate(net.txRate));
+    drawGraph(panel, "RX: ", history.series(MetricHistory::NetRx), 0.0f, view);
+    drawGraph(panel, "TX: ", history.series(MetricHistory::NetTx), 0.0f, view);
+
+    if (burst.hz > 0 && burst.network && burst.samples > 0) {
+        if (panel.newLine())
+            panel.print("Burst RX: min ", formatBitRate(burst.rxRate.min), " avg ", formatBitRate(burst.rxRate.avg),
+                        " max ", formatBitRate(burst.rxRate.max));
+        if (panel.newLine())
+            panel.print("Burst TX: min ", formatBitRate(burst.txRate.min), " avg ", formatBitRate(burst.txRate.avg),
+                        " max ", formatBitRate(burst.txRate.max));
+    }
+
+    if (!wifiSignal.empty() && panel.newLine()) {
+        string_view signal = wifiSignal;
+        while (!signal.empty() && isspace((unsigned char)signal.back()))
+            signal.remove_suffix(1);
+        panel.text("WiFi Signal: ");
+        panel.text(signal);
+    }
+
+    drawList(panel, interfaces, view.lists[NetworkPanel], view.focus == NetworkPanel, view.caps, area,
+             [&](const NetInterfaceInfo& iface) {
+        panel.print(iface.name, " → RX: ", formatBytes(iface.rxBytes), ", TX: ", formatBytes(iface.txBytes));
+    });
+}
+
+/// Fraction of a filesystem in use.
+double diskFill(const DiskInfo& disk) {
+    return disk.totalBytes > 0 ? double(disk.usedBytes) / disk.totalBytes : 0.0;
+}
+
+/// Disk list orders by SortKey; nullptr keeps the /proc/mounts order.
+constexpr array<ListView<DiskInfo>::Less, size_t(SortKey::Count)> DiskOrders = {
+    nullptr,
+    [](const DiskInfo& a, const DiskInfo& b) { return a.mountpoint < b.mountpoint; },
+    [](const DiskInfo& a, const DiskInfo& b) { return diskFill(a) > diskFill(b); },
+};
+
+/// Interface list orders by SortKey; nullptr keeps the /proc/net/dev order.
+constexpr array<ListView<NetInterfaceInfo>::Less, size_t(SortKey::Count)> InterfaceOrders = {
+    nullptr,
+    [](const NetInterfaceInfo& a, const NetInterfaceInfo& b) { return a.name < b.name; },
+    [](const NetInterfaceInfo& a, const NetInterfaceInfo& b) {
+        return a.rxRate + a.txRate > b.rxRate + b.txRate;
+    },
+};
+
+/**
+ * @brief Rows each panel would like to have for the given snapshot.
+ *
+ * Includes the blank separator row below the panel; hidden panels get none.
+ * The list panels ask for one row per entry left after filtering.
+ */
+array<int, PanelCount> preferredPanelRows(const Snapshot& snap, const ViewSettings& view,
+                                          size_t diskRows, size_t interfaceRows) {
+    const HzSnapshot& burst = snap.burst;
+    int graph = view.graphRows();
+    array<int, PanelCount> rows;
+    rows[MemoryPanel] = 3 + graph + 1;
+    rows[CPUPanel] = 2 + graph + (burst.hz > 0 && burst.cpu) + (snap.sensors.temperature > 0)
+                   + (snap.sensors.fanRPM > 0) + 1;
+    rows[BatteryPanel] = (snap.battery.available ? 3 : 2) + 1;
+    rows[DisksPanel] = 2 + 2 * graph + int(min<size_t>(diskRows, INT_MAX / 2)) + 1;
+    rows[NetworkPanel] = 2 + 2 * graph + 2 * (burst.hz > 0 && burst.network) + !snap.wifiSignal.empty()
+                       + int(min<size_t>(interfaceRows, INT_MAX / 2)) + 1;
+    for (int id = 0; id < PanelCount; ++id)
+        if (!view.panels[id])
+            rows[id] = 0;
+    return rows;
+}
+
+/**
+ * @brief Placement of every panel on the terminal.
+ */
+struct Layout {
+    int width = 0;                          ///< Terminal width the layout was computed for
+    int height = 0;                         ///< Terminal height the layout was computed for
+    array<int, PanelCount> wanted{};        ///< Preferred rows the layout was computed for
+    vector<int> columnStarts;               ///< x of each column
+    array<Rect, PanelCount> panels{};       ///< Rectangle of each panel; height 0 when not visible
+    array<int, PanelCount> columns{};       ///< Column index of each panel
+};
+
+/**
+ * @brief Distributes the panels over columns and rows of a terminal.
+ *
+ * Row 0 is the header. Panels that want rows keep their order and are
+ * split into as many columns as fit at MinPanelWidth, balancing column
+ * heights. When a
+ * column is too short, the list panels (disks, network) shrink first; what
+ * still does not fit is clipped at the bottom.
+ */
+Layout computeLayout(int width, int height, const array<int, PanelCount>& wanted) {
+    const int MinPanelWidth = 50;
+    const int MinListRows = 4;
+    const int MaxColumns = 3;
+
+    Layout layout;
+    layout.width = width;
+    layout.height = height;
+    layout.wanted = wanted;
+
+    vector<int> shown;
+    for (int id = 0; id < PanelCount; ++id)
+        if (wanted[id] > 0)
+            shown.push_back(id);
+    if (shown.empty()) {
+        layout.columnStarts.push_back(0);
+        return layout;
+    }
+
+    int columns = clamp(width / MinPanelWidth, 1, MaxColumns);
+    int total = 0;
+    for (int rows : wanted) total += rows;
+    int target = (total + columns - 1) / columns;
+
+    // Split the ordered panels into columns of roughly equal height
+    vector<vector<int>> assigned(columns);
+    int column = 0, used = 0;
+    for (size_t i = 0; i < shown.size(); ++i) {
+        int id = shown[i];
+        int remainingPanels = int(shown.size() - i);
+        int remainingColumns = columns - column - 1;
+        if (!assigned[column].empty() && column + 1 < columns
+            && (used + wanted[id] > target || remainingPanels <= remainingColumns)) {
+            ++column;
+            used = 0;
+        }
+        assigned[column].push_back(id);
+        used += wanted[id];
+    }
+    while (!assigned.empty() && assigned.back().empty())
+        assigned.pop_back();
+    columns = int(assigned.size());
+
+    int columnWidth = width / columns;
+    for (int c = 0; c < columns; ++c) {
+        int x = c * columnWidth;
+        int w = (c + 1 == columns ? width - x : columnWidth) - (c + 1 < columns); // 1-cell gutter
+        layout.columnStarts.push_back(x);
+
+        int available = height - 1;
+        int need = 0;
+        for (int id : assigned[c]) need += wanted[id];
+
+        array<int, PanelCount> rows = wanted;
+        for (int id : { NetworkPanel, DisksPanel }) { // shrink lists, last one first
+            if (need <= available) break;
+            if (find(assigned[c].begin(), assigned[c].end(), id) == assigned[c].end()) continue;
+            int cut = min(need - available, max(0, rows[id] - MinListRows));
+            rows[id] -= cut;
+            need -= cut;
+        }
+
+        int y = 1;
+        for (int id : assigned[c]) {
+            int h = max(0, min(rows[id], height - y));
+            layout.panels[id] = { x, y, w, h };
+            layout.columns[id] = c;
+            y += h;
+        }
+    }
+    return layout;
+}
+
+/// Set by the SIGWINCH handler; the main loop re-queries the terminal size.
+volatile sig_atomic_t terminalResized = 1;
+
+void onResize(int) {
+    terminalResized = 1;
+}
+
+/**
+ * @brief Queries the terminal size, falling back to $COLUMNS/$LINES or 80x24.
+ */
+void terminalSize(int& width, int& height) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        width = ws.ws_col;
+        height = ws.ws_row;
+        return;
+    }
+    const char* columns = getenv("COLUMNS");
+    const char* lines = getenv("LINES");
+    width = columns && atoi(columns) > 0 ? atoi(columns) : 80;
+    height = lines && atoi(lines) > 0 ? atoi(lines) : 24;
+}
+
+/**
+ * @brief Writes the whole buffer, retrying on partial writes.
+ */
+void writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) { this_thread::sleep_for(chrono::milliseconds(1)); continue; }
+            return;
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+/**
+ * @brief Asks the terminal whether it knows DEC mode 2026 (synchronized update).
+ *
+ * Sends a DECRQM query and waits briefly for the reply. Terminals that do
+ * not answer are treated as not supporting the mode. Expects stdin in
+ * non-canonical mode.
+ */
+bool probeSynchronizedOutput() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+        return false;
+    const char query[] = "\033[?2026$p";
+    writeAll(STDOUT_FILENO, query, sizeof(query) - 1);
+
+    // Reply: ESC [ ? 2026 ; Ps $ y, with Ps 1 or 2 when the mode is known
+    string reply;
+    Clock::time_point deadline = Clock::now() + chrono::milliseconds(100);
+    while (reply.find("$y") == string::npos) {
+        int left = int(chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count());
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        if (left <= 0 || poll(&pfd, 1, left) <= 0)
+            break;
+        char buffer[64];
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        reply.append(buffer, n);
+    }
+    size_t pos = reply.find("\033[?2026;");
+    return pos != string::npos && pos + 8 < reply.size()
+        && (reply[pos + 8] == '1' || reply[pos + 8] == '2');
+}
+
+/// Non-zero while the alternate screen is active and must be restored on exit.
+volatile sig_atomic_t fullScreenActive = 0;
+
+/**
+ * @brief Switches to the alternate screen buffer and hides the cursor.
+ *
+ * Also turns on mouse button and wheel reports in SGR encoding and
+ * bracketed paste, which InputParser decodes.
+ */
+void enterFullScreen() {
+    const char enter[] = "\033[?1049h\033[?25l\033[?1000h\033[?1006h\033[?2004h";
+    writeAll(STDOUT_FILENO, enter, sizeof(enter) - 1);
+    fullScreenActive = 1;
+}
+
+/**
+ * @brief Restores the main screen, the cursor and the terminal mode.
+ *
+ * Only uses async-signal-safe calls, so it also runs from signal handlers.
+ */
+void restoreTerminal() {
+    if (fullScreenActive) {
+        // End any half-written synchronized frame, stop mouse reports and bracketed paste,
+        // reset colors, show cursor, leave alternate screen
+        const char leave[] = "\033[?2026l\033[?2004l\033[?1006l\033[?1000l\033[0m\033[?25h\033[?1049l";
+        ssize_t ignored = write(STDOUT_FILENO, leave, sizeof(leave) - 1);
+        (void)ignored;
+        fullScreenActive = 0;
+    }
+    setNonBlocking(false);
+}
+
+/// Set by SIGINT, SIGTERM and SIGHUP to stop termistatd, the headless modes and an exporting view.
+volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * @brief Asks the loop to stop, so sockets and exported files are removed on the way out.
+ */
+void onStopSignal(int) {
+    stopRequested = 1;
+}
+
+/**
+ * @brief Restores the terminal, then lets the signal take its default action.
+ */
+void onTerminate(int sig) {
+    restoreTerminal();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/// Non-zero while stopped by Ctrl-Z out of full screen, which is re-entered on SIGCONT.
+volatile sig_atomic_t suspendedFullScreen = 0;
+
+/**
+ * @brief Restores the terminal before stopping on Ctrl-Z.
+ */
+void onSuspend(int) {
+    suspendedFullScreen = fullScreenActive;
+    restoreTerminal();
+    raise(SIGSTOP);
+}
+
+/**
+ * @brief Re-enters full screen after the job is resumed, if it was left for the stop.
+ *
+ * Without a capable terminal, or with output redirected, full screen was
+ * never entered and nothing is written.
+ */
+void onContinue(int) {
+    setNonBlocking(true);
+    if (suspendedFullScreen) {
+        suspendedFullScreen = 0;
+        enterFullScreen();
+    }
+    terminalResized = 1; // forces a full redraw
+}
+
+/**
+ * @brief Installs the handlers that keep the terminal usable after termistat ends.
+ *
+ * @param stopGracefully Let SIGINT, SIGTERM and SIGHUP set stopRequested
+ *        instead of ending the process at once, so destructors remove what
+ *        the exporters created.
+ */
+void installTerminalHandlers(bool stopGracefully) {
+    for (int sig : { SIGINT, SIGTERM, SIGHUP })
+        signal(sig, stopGracefully ? onStopSignal : onTerminate);
+    signal(SIGQUIT, onTerminate);
+    signal(SIGTSTP, onSuspend);
+    signal(SIGCONT, onContinue);
+    signal(SIGWINCH, onResize);
+    atexit(restoreTerminal);
+}
+
+/**
+ * @brief Lets SIGINT, SIGTERM and SIGHUP set stopRequested in the modes without a terminal.
+ *
+ * SIGPIPE is ignored, so a reader or client going away shows up as a
+ * failed write instead of ending the process.
+ */
+void installStopHandlers() {
+    for (int sig : { SIGINT, SIGTERM, SIGHUP })
+        signal(sig, onStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+}
+
+/**
+ * @brief Slows the frame rate down while the terminal cannot keep up.
+ *
+ * Before each frame the tty output queue (TIOCOUTQ) is checked; a frame is
+ * dropped while earlier output is still waiting, so the next one carries
+ * the newer state instead of adding to the backlog. Every drop or slow
+ * write doubles the frame interval, up to MaxSlowdown; a run of frames
+ * that drain promptly halves it again.
+ */
+class FramePacer {
+public:
+    static constexpr int MaxSlowdown = 8;
+    static constexpr int QueueLimit = 1024;    ///< Pending bytes that count as congestion
+    static constexpr int RecoverAfter = 3;     ///< Prompt frames needed before speeding up
+
+    /**
+     * @brief Whether a frame may be written now.
+     */
+    bool ready() {
+        int queued = 0;
+        if (ioctl(STDOUT_FILENO, TIOCOUTQ, &queued) == 0 && queued > QueueLimit) {
+            ++dropped_;
+            slowDown();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Records a written frame.
+     *
+     * @param budget Frame interval; writes taking more than half of it count as congestion.
+     */
+    void wrote(size_t bytes, Clock::duration took, Clock::duration budget) {
+        ++frames_;
+        bytes_ += bytes;
+        if (took > budget / 2) {
+            slowDown();
+        } else if (slowdown_ > 1 && ++promptFrames_ >= RecoverAfter) {
+            slowdown_ /= 2;
+            promptFrames_ = 0;
+        }
+
+        Clock::time_point now = Clock::now();
+        double elapsed = chrono::duration<double>(now - windowStart_).count();
+        if (elapsed >= 2.0) { // rates over a short sliding window
+            fps_ = frames_ / elapsed;
+            bytesPerSecond_ = bytes_ / elapsed;
+            frames_ = 0;
+            bytes_ = 0;
+            windowStart_ = now;
+        }
+    }
+
+    /// Interval to wait before the next frame.
+    Clock::duration interval(Clock::duration base) const { return base * slowdown_; }
+
+    int slowdown() const { return slowdown_; }
+    double fps() const { return fps_; }
+    double bytesPerSecond() const { return bytesPerSecond_; }
+    size_t dropped() const { return dropped_; }
+
+private:
+    void slowDown() {
+        slowdown_ = min(slowdown_ * 2, MaxSlowdown);
+        promptFrames_ = 0;
+    }
+
+    int slowdown_ = 1;
+    int promptFrames_ = 0;
+    size_t dropped_ = 0;
+    size_t frames_ = 0;
+    size_t bytes_ = 0;
+    Clock::time_point windowStart_ = Clock::now();
+    double fps_ = 0.0;
+    double bytesPerSecond_ = 0.0;
+};
+
+/**
+ * @brief Keys the input parser distinguishes.
+ */
+enum class Key {
+    Char,       ///< Printable or control character, see InputEvent::text
+    Enter, Escape, Backspace, Tab, BackTab,
+    Up, Down, Left, Right, Home, End, PageUp, PageDown, Insert, Delete,
+    Function    ///< Function key, see InputEvent::number
+};
+
+/**
+ * @brief What happened in a mouse report.
+ */
+enum class MouseAction { Press, Release, Drag, WheelUp, WheelDown };
+
+/// Modifier bits of InputEvent::modifiers.
+enum { ModShift = 1, ModAlt = 2, ModCtrl = 4 };
+
+/**
+ * @brief One decoded key press, paste or mouse report.
+ */
+struct InputEvent {
+    enum Type { KeyPress, Paste, Mouse };
+
+    Type type = KeyPress;
+    Key key = Key::Char;
+    string text;                ///< UTF-8 character of Key::Char, or the pasted text
+    int number = 0;             ///< Function key number (F1 = 1)
+    int modifiers = 0;          ///< ModShift | ModAlt | ModCtrl
+    MouseAction mouse = MouseAction::Press;
+    int button = 0;             ///< Mouse button: 0 left, 1 middle, 2 right
+    int x = 0;                  ///< Zero-based column of a mouse report
+    int y = 0;                  ///< Zero-based row of a mouse report
+};
+
+/**
+ * @brief State machine turning raw terminal input into InputEvents.
+ *
+ * Understands UTF-8 text, CSI and SS3 key sequences (with xterm modifier
+ * parameters), SGR mouse reports (mode 1006) and bracketed paste (mode
+ * 2004). Input can be fed in arbitrary chunks; a sequence split across two
+ * reads is completed by the next feed(). Unknown sequences are dropped.
+ */
+class InputParser {
+public:
+    /// How long a lone ESC waits for the rest of a sequence before it counts as the Escape key.
+    static constexpr chrono::milliseconds EscapeTimeout{25};
+
+    /**
+     * @brief Decodes @p size bytes, appending every completed event to @p out.
+     */
+    void feed(const char* data, size_t size, vector<InputEvent>& out) {
+        for (size_t i = 0; i < size; ++i)
+            step(data[i], out);
+    }
+
+    /// Whether an escape sequence has been started but not finished.
+    bool pending() const { return state_ == Escape || state_ == Csi || state_ == Ss3; }
+
+    /**
+     * @brief Gives up on an unfinished sequence; a lone ESC becomes the Escape key.
+     */
+    void flush(vector<InputEvent>& out) {
+        if (state_ == Escape)
+            out.push_back(keyEvent(Key::Escape));
+        if (pending())
+            state_ = Ground;
+    }
+
+private:
+    enum State { Ground, Escape, Csi, Ss3, Paste };
+
+    static constexpr size_t MaxSequence = 32;       ///< Longer parameter strings are garbage
+    static constexpr size_t MaxPaste = 64 * 1024;   ///< Pasted text beyond this is dropped
+    static constexpr string_view PasteEnd = "\033[201~";
+
+    static InputEvent keyEvent(Key key, int modifiers = 0) {
+        InputEvent event;
+        event.key = key;
+        event.modifiers = modifiers;
+        return event;
+    }
+
+    void step(char c, vector<InputEvent>& out) {
+        unsigned char byte = c;
+        switch (state_) {
+        case Ground:
+            ground(c, out);
+            break;
+        case Escape:
+            if (c == '[') {
+                state_ = Csi;
+                params_.clear();
+                intermediates_.clear();
+            } else if (c == 'O') {
+                state_ = Ss3;
+            } else if (c == '\033') {
+                out.push_back(keyEvent(Key::Escape));
+            } else {
+                // ESC before an ordinary key is how terminals send Alt+key
+                state_ = Ground;
+                size_t first = out.size();
+                ground(c, out);
+                for (size_t i = first; i < out.size(); ++i)
+                    out[i].modifiers |= ModAlt;
+            }
+            break;
+        case Csi:
+            if (byte >= 0x30 && byte <= 0x3F) {
+                params_ += c;
+            } else if (byte >= 0x20 && byte <= 0x2F) {
+                intermediates_ += c;
+            } else if (byte >= 0x40 && byte <= 0x7E) {
+                state_ = Ground;
+                dispatchCsi(c, out);
+            } else {
+                state_ = Ground; // malformed, treat the byte as fresh input
+                step(c, out);
+            }
+            if (params_.size() + intermediates_.size() > MaxSequence)
+                state_ = Ground;
+            break;
+        case Ss3:
+            state_ = Ground;
+            dispatchSs3(c, out);
+            break;
+        case Paste:
+            // The terminator is matched apart from the text, so a paste cut at MaxPaste still ends
+            if (c == PasteEnd[pasteEndMatched_]) {
+                if (++pasteEndMatched_ < PasteEnd.size())
+                    break;
+                InputEvent event;
+                event.type = InputEvent::Paste;
+                event.text = move(paste_);
+                out.push_back(move(event));
+                paste_.clear();
+                pasteEndMatched_ = 0;
+                state_ = Ground;
+                break;
+            }
+            // A partial match was text after all; only its ESC can start the terminator again
+            appendPaste(PasteEnd.substr(0, pasteEndMatched_));
+            pasteEndMatched_ = c == PasteEnd[0] ? 1 : 0;
+            if (pasteEndMatched_ == 0)
+                appendPaste(string_view(&c, 1));
+            break;
+        }
+    }
+
+    void appendPaste(string_view text) {
+        paste_.append(text.substr(0, MaxPaste - min(MaxPaste, paste_.size())));
+    }
+
+    void ground(char c, vector<InputEvent>& out) {
+        unsigned char byte = c;
+        if (utf8Left_ > 0 && (byte & 0xC0) == 0x80) {
+            utf8_ += c;
+            if (--utf8Left_ == 0) {
+                InputEvent event = keyEvent(Key::Char);
+                event.text = move(utf8_);
+                out.push_back(move(event));
+                utf8_.clear();
+            }
+            return;
+        }
+        utf8Left_ = 0;
+        utf8_.clear();
+
+        if (byte >= 0xC0) { // lead byte of a multi-byte character
+            utf8_ = c;
+            utf8Left_ = byte >= 0xF0 ? 3 : byte >= 0xE0 ? 2 : 1;
+            return;
+        }
+        switch (byte) {
+        case 0x1B: state_ = Escape; return;
+        case '\r': case '\n': out.push_back(keyEvent(Key::Enter)); return;
+        case '\t': out.push_back(keyEvent(Key::Tab)); return;
+        case 0x7F: case '\b': out.push_back(keyEvent(Key::Backspace)); return;
+        }
+        if (byte >= 0x80)
+            return; // stray continuation byte
+        InputEvent event = keyEvent(Key::Char, byte < 0x20 ? ModCtrl : 0);
+        event.text = c;
+        out.push_back(move(event));
+    }
+
+    /// Splits "1;5" into numbers; missing numbers are 0.
+    static array<int, 4> numbers(string_view params) {
+        array<int, 4> values{};
+        size_t index = 0;
+        for (char c : params) {
+            if (c == ';') {
+                if (++index == values.size()) break;
+            } else if (c >= '0' && c <= '9') {
+                values[index] = values[index] * 10 + (c - '0');
+            }
+        }
+        return values;
+    }
+
+    /// Modifier bits from an xterm modifier parameter (1 + Shift/Alt/Ctrl bits).
+    static int modifiersFrom(int parameter) {
+        return parameter > 1 ? (parameter - 1) & (ModShift | ModAlt | ModCtrl) : 0;
+    }
+
+    void dispatchSs3(char final, vector<InputEvent>& out) {
+        switch (final) {
+        case 'A': out.push_back(keyEvent(Key::Up)); break;
+        case 'B': out.push_back(keyEvent(Key::Down)); break;
+        case 'C': out.push_back(keyEvent(Key::Right)); break;
+        case 'D': out.push_back(keyEvent(Key::Left)); break;
+        case 'H': out.push_back(keyEvent(Key::Home)); break;
+        case 'F': out.push_back(keyEvent(Key::End)); break;
+        case 'M': out.push_back(keyEvent(Key::Enter)); break;
+        case 'P': case 'Q': case 'R': case 'S': {
+            InputEvent event = keyEvent(Key::Function);
+            event.number = final - 'P' + 1;
+            out.push_back(move(event));
+            break;
+        }
+        }
+    }
+
+    void dispatchCsi(char final, vector<InputEvent>& out) {
+        if (!intermediates_.empty())
+            return; // mode reports and other replies, not input
+        if (!params_.empty() && params_[0] == '<') {
+            if (final == 'M' || final == 'm')
+                mouseReport(final == 'M', out);
+            return;
+        }
+        if (!params_.empty() && (params_[0] < '0' || params_[0] > ';'))
+            return; // other private sequences
+
+        array<int, 4> p = numbers(params_);
+        int modifiers = modifiersFrom(p[1]);
+        Key key;
+        switch (final) {
+        case 'A': key = Key::Up; break;
+        case 'B': key = Key::Down; break;
+        case 'C': key = Key::Right; break;
+        case 'D': key = Key::Left; break;
+        case 'H': key = Key::Home; break;
+        case 'F': key = Key::End; break;
+        case 'Z': key = Key::BackTab; break;
+        case 'P': case 'Q': case 'R': case 'S': {
+            InputEvent event = keyEvent(Key::Function, modifiers);
+            event.number = final - 'P' + 1;
+            out.push_back(move(event));
+            return;
+        }
+        case '~':
+            switch (p[0]) {
+            case 1: case 7: key = Key::Home; break;
+            case 2: key = Key::Insert; break;
+            case 3: key = Key::Delete; break;
+            case 4: case 8: key = Key::End; break;
+            case 5: key = Key::PageUp; break;
+            case 6: key = Key::PageDown; break;
+            case 200:
+                state_ = Paste;
+                paste_.clear();
+                pasteEndMatched_ = 0;
+                return;
+            default: {
+                // F1-F12 use the codes 11-15, 17-21 and 23-24
+                static constexpr array<int, 12> codes = { 11, 12, 13, 14, 15, 17, 18, 19, 20, 21, 23, 24 };
+                auto it = find(codes.begin(), codes.end(), p[0]);
+                if (it == codes.end())
+                    return;
+                InputEvent event = keyEvent(Key::Function, modifiers);
+                event.number = int(it - codes.begin()) + 1;
+                out.push_back(move(event));
+                return;
+            }
+            }
+            break;
+        default:
+            return;
+        }
+        out.push_back(keyEvent(key, modifiers));
+    }
+
+    /// Decodes "<b;x;y" of an SGR mouse report.
+    void mouseReport(bool press, vector<InputEvent>& out) {
+        array<int, 4> p = numbers(string_view(params_).substr(1));
+        int code = p[0];
+        InputEvent event;
+        event.type = InputEvent::Mouse;
+        event.button = code & 3;
+        event.x = max(0, p[1] - 1);
+        event.y = max(0, p[2] - 1);
+        event.modifiers = ((code & 4) ? ModShift : 0) | ((code & 8) ? ModAlt : 0) | ((code & 16) ? ModCtrl : 0);
+        if (code & 64) {
+            if (event.button > 1)
+                return; // horizontal wheel
+            event.mouse = event.button == 0 ? MouseAction::WheelUp : MouseAction::WheelDown;
+        } else if (code & 32) {
+            event.mouse = MouseAction::Drag;
+        } else {
+            event.mouse = press ? MouseAction::Press : MouseAction::Release;
+        }
+        out.push_back(move(event));
+    }
+
+    State state_ = Ground;
+    string params_;
+    string intermediates_;
+    string paste_;
+    size_t pasteEndMatched_ = 0;    ///< Bytes of PasteEnd seen so far
+    string utf8_;
+    int utf8Left_ = 0;
+};
+
+/**
+ * @brief Reads everything stdin has buffered and decodes it.
+ *
+ * @return false once stdin has reached end of file.
+ */
+bool readInput(InputParser& parser, vector<InputEvent>& events) {
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        parser.feed(buffer, n, events);
+        if (size_t(n) < sizeof(buffer))
+            return true;
+    }
+    return n != 0;
+}
+
+/// Frame intervals selectable with - and +.
+constexpr array<chrono::milliseconds, 6> RefreshIntervals = {
+    chrono::milliseconds(250), chrono::milliseconds(500), chrono::milliseconds(1000),
+    chrono::milliseconds(2000), chrono::milliseconds(5000), chrono::milliseconds(10000),
+};
+
+/**
+ * @brief Interactive state driven from the keyboard.
+ */
+struct Controls {
+    size_t intervalIndex = 2;       ///< Index into RefreshIntervals
+    bool paused = false;            ///< Display frozen; collection and history continue
+    bool editingFilter = false;     ///< Keys are typed into the filter
+    bool redraw = false;            ///< State changed; render without waiting for the next frame
+    bool quit = false;
+
+    Clock::duration interval() const { return RefreshIntervals[intervalIndex]; }
+};
+
+/**
+ * @brief termistat's own resource use, averaged over the frames of a short window.
+ *
+ * CPU time comes from getrusage(), the resident set from /proc/self/statm
+ * and system calls from the read/write call counters in /proc/self/io;
+ * all cover every thread, so collectors are included.
+ */
+class SelfMonitor {
+public:
+    struct Stats {
+        double cpuNsPerFrame = 0.0;     ///< User plus system CPU time per frame
+        double cpuPercent = 0.0;        ///< CPU time as a share of wall time
+        double rssBytes = 0.0;          ///< Resident set size
+        double readWriteCallsPerFrame = 0.0; ///< read- and write-family system calls per frame (syscr + syscw)
+        double bytesPerFrame = 0.0;     ///< Bytes written to the terminal per frame
+    };
+
+    SelfMonitor() : statm_("/proc/self/statm"), io_("/proc/self/io") { sample(start_); }
+
+    /**
+     * @brief Records a written frame; refreshes stats() once the window is over.
+     */
+    void frame(size_t bytesWritten) {
+        ++frames_;
+        bytes_ += bytesWritten;
+        Reading now;
+        if (chrono::duration<double>(Clock::now() - start_.time).count() < 1.0)
+            return;
+        sample(now);
+        double frames = double(frames_);
+        double wall = chrono::duration<double, nano>(now.time - start_.time).count();
+        stats_.cpuNsPerFrame = (now.cpuNs - start_.cpuNs) / frames;
+        stats_.cpuPercent = wall > 0 ? 100.0 * (now.cpuNs - start_.cpuNs) / wall : 0.0;
+        stats_.rssBytes = now.rssBytes;
+        stats_.readWriteCallsPerFrame = (now.readWriteCalls - start_.readWriteCalls) / frames;
+        stats_.bytesPerFrame = bytes_ / frames;
+        start_ = now;
+        frames_ = 0;
+        bytes_ = 0;
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Reading {
+        Clock::time_point time;
+        double cpuNs = 0.0;
+        double rssBytes = 0.0;
+        double readWriteCalls = 0.0;
+    };
+
+    void sample(Reading& out) {
+        out.time = Clock::now();
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            out.cpuNs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e9
+                      + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e3;
+
+        string_view statm = statm_.readAll(); // "size resident shared ..." in pages
+        const char* p = statm.data();
+        const char* end = p + statm.size();
+        parseNumber(p, end);
+        out.rssBytes = double(parseNumber(p, end)) * sysconf(_SC_PAGESIZE);
+
+        string_view io = io_.readAll();
+        out.readWriteCalls = 0;
+        for (string_view key : { "syscr:", "syscw:" }) {
+            size_t pos = io.find(key);
+            if (pos == string_view::npos) continue;
+            const char* q = io.data() + pos + key.size();
+            out.readWriteCalls += parseNumber(q, io.data() + io.size());
+        }
+    }
+
+    ProcFile statm_;
+    ProcFile io_;
+    Reading start_;
+    size_t frames_ = 0;
+    size_t bytes_ = 0;
+    Stats stats_;
+};
+
+/**
+ * @brief Lays out and renders snapshots into whole frames.
+ */
+class Renderer {
+public:
+    /**
+     * @param collectors Collectors whose costs the self-monitoring overlay lists.
+     */
+    explicit Renderer(const CollectorRegistry& collectors) : collectors_(collectors) {}
+
+    /**
+     * @brief Renders @p snap and writes the frame to stdout in one go.
+     *
+     * On terminals that support it the frame is wrapped in a synchronized
+     * update, so it is displayed atomically. The frame is skipped while the
+     * terminal is still draining earlier output.
+     *
+     * @param interval Nominal frame interval, used to judge slow writes.
+     */
+    void render(const Snapshot& snap, const MetricHistory& history, const ViewSettings& view,
+                const Controls& controls, Clock::duration interval) {
+        bool resized = terminalResized;
+        if (resized) {
+            terminalResized = 0;
+            clearPending_ = true;
+            terminalSize(width_, height_);
+        }
+        if (!pacer_.ready())
+            return;
+        ScopedTimer timer(frameCost_, "frame", "render");
+
+        disks_.reset(snap.disks, view.filter, [](const DiskInfo& d) -> const string& { return d.mountpoint; },
+                     DiskOrders[size_t(view.sort)], view.sortReversed);
+        interfaces_.reset(snap.network.interfaces, view.filter,
+                          [](const NetInterfaceInfo& i) -> const string& { return i.name; },
+                          InterfaceOrders[size_t(view.sort)], view.sortReversed);
+        array<int, PanelCount> wanted = preferredPanelRows(snap, view, disks_.size(), interfaces_.size());
+        if (resized || wanted != layout_.wanted) {
+            layout_ = computeLayout(width_, height_, wanted);
+            screen_.resize(width_, height_, layout_.columnStarts);
+        }
+
+        screen_.clear();
+        Panel header(screen_, { 0, 0, width_, 1 }, 0);
+        header.newLine();
+        header.style(view.caps.sgr(SgrHeader));
+        header.text("*** TermiStat ***");
+        header.style(view.caps.sgr(SgrReset));
+        header.print("  history ", formatBytes(history.memoryBytes()), "  ", formatFixed(pacer_.fps(), 1),
+                     " fps ", formatByteRate(pacer_.bytesPerSecond()));
+        if (pacer_.slowdown() > 1)
+            header.print(" (slowed x", formatInt(pacer_.slowdown()), ", ", formatInt(pacer_.dropped()), " dropped)");
+        drawStatus(header, view, controls);
+
+        lists_ = {};
+        for (int id = 0; id < PanelCount; ++id) {
+            const Rect& rect = layout_.panels[id];
+            if (rect.height == 0) continue;
+            Panel panel(screen_, { rect.x, rect.y, rect.width, rect.height - 1 }, layout_.columns[id]);
+            ScopedTimer timer(panelCost_[id], PanelNames[id], "render");
+            switch (id) {
+            case MemoryPanel:  renderMemory(panel, snap.memory, history, view); break;
+            case CPUPanel:     renderCPU(panel, snap.cpu, snap.sensors, snap.burst, history, view); break;
+            case BatteryPanel: renderBattery(panel, snap.battery, view); break;
+            case DisksPanel:
+                renderDisks(panel, disks_, snap.diskIO, history, view, lists_[id]);
+                break;
+            case NetworkPanel:
+                renderNetwork(panel, snap.network, interfaces_, snap.wifiSignal, snap.burst, history, view,
+                              lists_[id]);
+                break;
+            }
+        }
+
+        if (view.selfStats)
+            drawSelfStats(view);
+
+        frame_.clear();
+        {
+            ScopedTimer timer(composeCost_, "compose", "render");
+            if (view.caps.synchronizedOutput)
+                frame_ += "\033[?2026h";
+            if (clearPending_ && view.caps.cursorAddressing)
+                frame_ += "\033[2J";
+            clearPending_ = false;
+            screen_.compose(frame_, view.caps);
+            if (view.caps.synchronizedOutput)
+                frame_ += "\033[?2026l";
+            if (!view.caps.cursorAddressing)
+                frame_ += "\n\n"; // frames simply follow each other
+        }
+
+        int64_t start = monotonicNs();
+        writeAll(STDOUT_FILENO, frame_.data(), frame_.size());
+        int64_t took = monotonicNs() - start;
+        writeCost_.add(took);
+        if (activeTrace)
+            activeTrace->record("write", "render", start, took);
+        pacer_.wrote(frame_.size(), chrono::nanoseconds(took), interval);
+        self_.frame(frame_.size());
+    }
+
+    /**
+     * @brief Draws termistat's own cost over the top of the rightmost column.
+     */
+    void drawSelfStats(const ViewSettings& view) {
+        int column = int(layout_.columnStarts.size()) - 1;
+        int x = layout_.columnStarts.back();
+        int rows = 6 + int(collectors_.size()) + PanelCount + 3;
+        Rect rect = { x, 1, width_ - x, min(rows, height_ - 1) };
+        screen_.clearSlots(column, rect.y, rect.height);
+
+        Panel panel(screen_, rect, column);
+        const SelfMonitor::Stats& stats = self_.stats();
+        drawTitle(panel, "termistat", view.caps);
+        if (panel.newLine())
+            panel.print("CPU ", formatDuration(stats.cpuNsPerFrame), "/frame (", formatFixed(stats.cpuPercent, 2),
+                        "%)  RSS ", formatBytes(stats.rssBytes));
+        if (panel.newLine())
+            panel.print("Read/write calls ", formatFixed(stats.readWriteCallsPerFrame, 1), "/frame  written ",
+                        formatBytes(stats.bytesPerFrame), "/frame");
+        panel.line("");
+        auto costLine = [&](string_view name, const CostCounter& cost, string_view note) {
+            if (!panel.newLine()) return;
+            const LatencyHistogram& h = cost.histogram;
+            panel.print("  ", name, string_view("          ", 10 - min<size_t>(10, name.size())),
+                        formatDuration(cost.lastNs.load(memory_order_relaxed)), " ",
+                        formatDuration(h.percentile(50)), " ", formatDuration(h.percentile(99)), " ",
+                        formatDuration(h.max()), note);
+        };
+        panel.line("Collector       last      p50      p99      max");
+        for (size_t i = 0; i < collectors_.size(); ++i) {
+            const Collector& collector = collectors_[i];
+            costLine(collector.name(), collector.cost,
+                     collector.enabled.load(memory_order_relaxed) ? "" : "  suspended");
+        }
+        panel.line("Render          last      p50      p99      max");
+        for (int id = 0; id < PanelCount; ++id)
+            costLine(PanelNames[id], panelCost_[id], "");
+        costLine("frame", frameCost_, "");
+        costLine("compose", composeCost_, "");
+        costLine("write", writeCost_, "");
+    }
+
+    /**
+     * @brief Appends the interactive state and key hints to the header line.
+     */
+    static void drawStatus(Panel& header, const ViewSettings& view, const Controls& controls) {
+        static constexpr array<const char*, size_t(SortKey::Count)> sortNames = { "natural", "name", "usage" };
+        if (controls.paused) {
+            header.style(view.caps.sgr(SgrTitle));
+            header.text("  PAUSED");
+            header.style(view.caps.sgr(SgrReset));
+        }
+        header.print("  every ", formatFixed(chrono::duration<double>(controls.interval()).count(), 2), " s");
+        if (view.sort != SortKey::Natural || view.sortReversed)
+            header.print("  sort ", sortNames[size_t(view.sort)], view.sortReversed ? " (reversed)" : "");
+        if (controls.editingFilter || !view.filter.empty())
+            header.print("  /", view.filter, controls.editingFilter ? "_" : "");
+        header.text("  q quit  space pause  -/+ interval  1-5 panels  s/r sort  / filter  Tab/arrows/mouse lists"
+                    "  o self stats");
+    }
+
+    /// Interval until the next frame, stretched while the terminal is congested.
+    Clock::duration frameInterval(Clock::duration base) const { return pacer_.interval(base); }
+
+    /// Whether panel @p id got any rows in the last frame.
+    bool panelShown(PanelId id) const { return layout_.panels[id].height > 0; }
+
+    /// Where the list of panel @p id was drawn in the last frame.
+    const ListArea& listArea(PanelId id) const { return lists_[id]; }
+
+    /**
+     * @brief Panel under the screen cell (@p x, @p y), or PanelCount if none.
+     */
+    PanelId panelAt(int x, int y) const {
+        for (int id = 0; id < PanelCount; ++id) {
+            const Rect& r = layout_.panels[id];
+            if (x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height)
+                return PanelId(id);
+        }
+        return PanelCount;
+    }
+
+private:
+    FramePacer pacer_;
+    bool clearPending_ = false;
+    int width_ = 80;
+    int height_ = 24;
+    Layout layout_;
+    Screen screen_;
+    string frame_;
+    array<ListArea, PanelCount> lists_{};
+    const CollectorRegistry& collectors_;
+    SelfMonitor self_;
+    array<CostCounter, PanelCount> panelCost_;
+    CostCounter frameCost_;
+    CostCounter composeCost_;
+    CostCounter writeCost_;
+    ListView<DiskInfo> disks_;
+    ListView<NetInterfaceInfo> interfaces_;
+};
+
+/**
+ * @brief Moves the selection of a list by @p delta entries and scrolls it into view.
+ */
+void moveSelection(ListCursor& cursor, const ListArea& area, long delta) {
+    if (area.count == 0)
+        return;
+    long selected = clamp(long(cursor.selected) + delta, 0L, long(area.count) - 1);
+    size_t rows = max(1, area.rows.height);
+    cursor.selected = size_t(selected);
+    cursor.top = area.top;
+    if (cursor.selected < cursor.top)
+        cursor.top = cursor.selected;
+    else if (cursor.selected >= cursor.top + rows)
+        cursor.top = cursor.selected - rows + 1;
+}
+
+/**
+ * @brief Scrolls a list by @p delta rows without moving the selection.
+ */
+void scrollList(ListCursor& cursor, const ListArea& area, long delta) {
+    long last = max(0L, long(area.count) - area.rows.height);
+    cursor.top = size_t(clamp(long(area.top) + delta, 0L, last));
+}
+
+/**
+ * @brief Applies one input event to the interactive state.
+ *
+ * Keys: q or Enter quits, space or p pauses, - and + change the refresh
+ * interval, 1-5 toggle panels, s cycles the sort key, r reverses it, /
+ * starts typing a filter (Enter keeps it, Esc clears it), o toggles the
+ * self-monitoring overlay. Tab switches the
+ * focused list; arrows, Page Up/Down, Home and End move its selection.
+ * The mouse wheel scrolls the list under the pointer and a click selects.
+ *
+ * @param renderer Supplies the list geometry of the last frame.
+ */
+void handleInput(const InputEvent& event, Controls& controls, ViewSettings& view, const Renderer& renderer) {
+    const int WheelRows = 3;
+
+    if (event.type == InputEvent::Mouse) {
+        PanelId panel = renderer.panelAt(event.x, event.y);
+        if (panel != DisksPanel && panel != NetworkPanel)
+            return;
+        const ListArea& area = renderer.listArea(panel);
+        ListCursor& cursor = view.lists[panel];
+        if (event.mouse == MouseAction::WheelUp || event.mouse == MouseAction::WheelDown) {
+            scrollList(cursor, area, event.mouse == MouseAction::WheelUp ? -WheelRows : WheelRows);
+        } else if (event.mouse == MouseAction::Press && event.button == 0) {
+            view.focus = panel;
+            int row = event.y - area.rows.y;
+            if (row >= 0 && row < area.rows.height && area.top + row < area.count) {
+                cursor.top = area.top;
+                cursor.selected = area.top + row;
+            }
+        } else {
+            return;
+        }
+        controls.redraw = true;
+        return;
+    }
+
+    if (controls.editingFilter) {
+        if (event.type == InputEvent::Paste) {
+            for (char c : event.text)
+                if ((unsigned char)c >= ' ')
+                    view.filter += c;
+        } else if (event.key == Key::Enter) {
+            controls.editingFilter = false;
+        } else if (event.key == Key::Escape) {
+            view.filter.clear();
+            controls.editingFilter = false;
+        } else if (event.key == Key::Backspace) {
+            while (!view.filter.empty() && (view.filter.back() & 0xC0) == 0x80)
+                view.filter.pop_back(); // continuation bytes of a multi-byte character
+            if (!view.filter.empty())
+                view.filter.pop_back();
+        } else if (event.key == Key::Char && event.modifiers == 0) {
+            view.filter += event.text;
+        } else {
+            return;
+        }
+        controls.redraw = true;
+        return;
+    }
+    if (event.type != InputEvent::KeyPress)
+        return;
+
+    const ListArea& area = renderer.listArea(view.focus);
+    ListCursor& cursor = view.lists[view.focus];
+    long page = max(1, area.rows.height);
+    switch (event.key) {
+    case Key::Enter:
+        controls.quit = true;
+        return;
+    case Key::Escape:
+        view.filter.clear();
+        break;
+    case Key::Tab: case Key::BackTab:
+        view.focus = view.focus == DisksPanel ? NetworkPanel : DisksPanel;
+        break;
+    case Key::Up:       moveSelection(cursor, area, -1); break;
+    case Key::Down:     moveSelection(cursor, area, 1); break;
+    case Key::PageUp:   moveSelection(cursor, area, -page); break;
+    case Key::PageDown: moveSelection(cursor, area, page); break;
+    case Key::Home:     moveSelection(cursor, area, -long(area.count)); break;
+    case Key::End:      moveSelection(cursor, area, long(area.count)); break;
+    case Key::Char:
+        if (event.modifiers != 0 || event.text.size() != 1)
+            return;
+        switch (event.text[0]) {
+        case 'q':
+            controls.quit = true;
+            return;
+        case ' ': case 'p':
+            controls.paused = !controls.paused;
+            break;
+        case '-':
+            if (controls.intervalIndex > 0)
+                --controls.intervalIndex;
+            break;
+        case '+': case '=':
+            if (controls.intervalIndex + 1 < RefreshIntervals.size())
+                ++controls.intervalIndex;
+            break;
+        case '1': case '2': case '3': case '4': case '5':
+            view.panels[event.text[0] - '1'] = !view.panels[event.text[0] - '1'];
+            break;
+        case 's':
+            view.sort = SortKey((int(view.sort) + 1) % int(SortKey::Count));
+            break;
+        case 'r':
+            view.sortReversed = !view.sortReversed;
+            break;
+        case 'o':
+            view.selfStats = !view.selfStats;
+            break;
+        case '/':
+            view.filter.clear();
+            controls.editingFilter = true;
+            break;
+        default:
+            return;
+        }
+        break;
+    default:
+        return;
+    }
+    controls.redraw = true;
+}
+
+/**
+ * @brief Reasons to keep a collector running; it is suspended while none applies.
+ */
+enum Demand : unsigned {
+    DemandDisplay = 1,  ///< Its panel is on screen
+    DemandHistory = 2,  ///< It feeds MetricHistory and its panel is switched on
+    DemandExport = 4,   ///< Snapshots are published outside termistat
+};
+
+/// Collectors read by MetricHistory::record().
+constexpr array<const char*, 4> HistoryCollectors = { "cpu", "memory", "network", "diskio" };
+
+/**
+ * @brief Suspends the collectors nothing needs and resumes the rest.
+ *
+ * Panels switched off with 1-5 stop all their sources. Panels that are
+ * switched on but did not fit on the terminal keep only the sources that
+ * feed the history graphs, so sensors, battery, mount and iwconfig
+ * sampling stop while their graphs stay continuous. While snapshots are
+ * exported every collector keeps running.
+ *
+ * @param sampler High-frequency sampler, or nullptr when --hz is off.
+ * @param exporting Whether snapshots are published outside termistat.
+ */
+void updateCollectorDemand(const ViewSettings& view, const Renderer& renderer, CollectorRegistry& registry,
+                           CollectorScheduler& scheduler, HzSampler* sampler, bool exporting) {
+    vector<unsigned> demand(registry.size(), exporting ? DemandExport : 0u);
+    for (int id = 0; id < PanelCount; ++id) {
+        if (!view.panels[id]) continue;
+        for (const char* name : PanelCollectors[id]) {
+            if (!name) continue;
+            size_t index = registry.find(name);
+            if (index == registry.size()) continue;
+            if (renderer.panelShown(PanelId(id)))
+                demand[index] |= DemandDisplay;
+            for (const char* recorded : HistoryCollectors)
+                if (strcmp(name, recorded) == 0)
+                    demand[index] |= DemandHistory;
+        }
+    }
+    for (size_t index = 0; index < registry.size(); ++index)
+        scheduler.setEnabled(index, demand[index] != 0);
+    if (sampler) // burst lines are only ever displayed
+        sampler->setEnabled(view.panels[CPUPanel] && renderer.panelShown(CPUPanel),
+                            view.panels[NetworkPanel] && renderer.panelShown(NetworkPanel));
+}
+
+/// How often termistatd and the exporters publish a snapshot; the fastest collector interval.
+constexpr chrono::milliseconds PublishInterval{250};
+
+/// How long the first snapshot waits, which lets the initial collection pass land.
+constexpr chrono::milliseconds FirstSnapshotDelay{200};
+
+/**
+ * @brief Moves a periodic @p deadline on by @p interval, restarting from @p now after a stall instead of catching up.
+ */
+void advanceDeadline(Clock::time_point& deadline, Clock::time_point now, Clock::duration interval) {
+    deadline += interval;
+    if (deadline < now)
+        deadline = now + interval;
+}
+
+/**
+ * @brief Where termistatd listens and viewers look for it unless --socket says otherwise.
+ *
+ * $XDG_RUNTIME_DIR/termistatd.sock is private to the user; root without a
+ * runtime directory uses /run, which only root can write to. Anywhere else
+ * there is no default: a socket in a shared directory such as /tmp could
+ * be bound by any local user, so using one takes an explicit --socket.
+ *
+ * @return The path, or an empty string if there is no safe default.
+ */
+string defaultSocketPath() {
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && runtime[0] == '/')
+        return string(runtime) + "/termistatd.sock";
+    if (geteuid() == 0)
+        return "/run/termistatd.sock";
+    return {};
+}
+
+/// Start of every snapshot frame; the low byte is the format version.
+constexpr uint32_t SnapshotFrameTag = 0x54534402;
+
+/// Largest frame a viewer accepts, so a corrupt length cannot exhaust memory.
+constexpr uint32_t MaxSnapshotFrame = 256u << 20;
+
+/**
+ * @brief Appends fixed-size values and length-prefixed strings to a byte buffer.
+ *
+ * The daemon and its viewers share a host, so values keep their native
+ * byte order.
+ */
+class WireWriter {
+public:
+    explicit WireWriter(string& out) : out_(out) {}
+
+    template <typename T>
+    void put(T value) {
+        static_assert(is_trivially_copyable_v<T>);
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(const string& s) {
+        put(uint32_t(s.size()));
+        out_ += s;
+    }
+
+private:
+    string& out_;
+};
+
+/**
+ * @brief Reads what WireWriter wrote; running past the end clears ok().
+ */
+class WireReader {
+public:
+    explicit WireReader(string_view in) : in_(in) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (in_.size() < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        memcpy(&value, in_.data(), sizeof(T));
+        in_.remove_prefix(sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Reads a string, dropping C0 and C1 control characters.
+     *
+     * Every string in a frame ends up on a terminal, so whoever sends the
+     * frame must not be able to inject escape sequences.
+     */
+    string getString() {
+        uint32_t size = get<uint32_t>();
+        if (in_.size() < size) {
+            ok_ = false;
+            return {};
+        }
+        string_view raw = in_.substr(0, size);
+        in_.remove_prefix(size);
+        string s;
+        s.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            unsigned char c = raw[i];
+            if (c < 0x20 || c == 0x7f)
+                continue;
+            if (c == 0xc2 && i + 1 < raw.size() && (unsigned char)raw[i + 1] >= 0x80
+                && (unsigned char)raw[i + 1] <= 0x9f) {
+                ++i; // U+0080-U+009F in UTF-8
+                continue;
+            }
+            s += char(c);
+        }
+        return s;
+    }
+
+    /// Entry count that the remaining bytes could hold at @p minEntrySize each, for reserve().
+    size_t plausibleCount(uint32_t count, size_t minEntrySize) const {
+        return min<size_t>(count, in_.size() / minEntrySize);
+    }
+
+    bool ok() const { return ok_; }
+    bool done() const { return in_.empty(); }
+
+private:
+    string_view in_;
+    bool ok_ = true;
+};
+
+/**
+ * @brief Serialises @p snap into @p frame as a length-prefixed termistatd frame.
+ *
+ * Snapshot::time is not sent; viewers stamp snapshots when they arrive.
+ */
+void encodeSnapshotFrame(const Snapshot& snap, string& frame) {
+    frame.clear();
+    WireWriter out(frame);
+    out.put(uint32_t(0)); // payload size, patched below
+    out.put(SnapshotFrameTag);
+    out.put<int64_t>(snap.memory.totalKB);
+    out.put<int64_t>(snap.memory.availableKB);
+    out.put(snap.cpu.usage);
+    out.put<uint8_t>(snap.cpu.sampled);
+    out.put(snap.sensors.temperature);
+    out.put<int32_t>(snap.sensors.fanRPM);
+    out.put<int32_t>(snap.battery.capacity);
+    out.put(snap.battery.status);
+    out.put<uint8_t>(snap.battery.available);
+    out.put<uint32_t>(snap.disks.size());
+    for (const DiskInfo& disk : snap.disks) {
+        out.put(disk.mountpoint);
+        out.put<uint64_t>(disk.totalBytes);
+        out.put<uint64_t>(disk.usedBytes);
+    }
+    out.put(snap.diskIO.readRate);
+    out.put(snap.diskIO.writeRate);
+    out.put<uint8_t>(snap.diskIO.sampled);
+    out.put(snap.network.rxRate);
+    out.put(snap.network.txRate);
+    out.put<uint8_t>(snap.network.sampled);
+    out.put<uint32_t>(snap.network.interfaces.size());
+    for (const NetInterfaceInfo& iface : snap.network.interfaces) {
+        out.put(iface.name);
+        out.put<int64_t>(iface.rxBytes);
+        out.put<int64_t>(iface.txBytes);
+        out.put(iface.rxRate);
+        out.put(iface.txRate);
+    }
+    out.put(snap.wifiSignal);
+    const HzSnapshot& burst = snap.burst;
+    out.put<int32_t>(burst.hz);
+    out.put<uint8_t>(burst.cpu);
+    out.put<uint8_t>(burst.network);
+    out.put<uint64_t>(burst.samples);
+    out.put<uint64_t>(burst.dropped);
+    for (const BurstStats* stats : { &burst.cpuUsage, &burst.rxRate, &burst.txRate }) {
+        out.put(stats->min);
+        out.put(stats->avg);
+        out.put(stats->max);
+    }
+    uint32_t payload = uint32_t(frame.size() - sizeof(uint32_t));
+    memcpy(frame.data(), &payload, sizeof(payload));
+}
+
+/**
+ * @brief Parses the payload of a frame written by encodeSnapshotFrame().
+ *
+ * @return false if the payload is truncated or of another format version.
+ */
+bool decodeSnapshot(string_view payload, Snapshot& snap) {
+    WireReader in(payload);
+    if (in.get<uint32_t>() != SnapshotFrameTag)
+        return false;
+    snap.memory.totalKB = in.get<int64_t>();
+    snap.memory.availableKB = in.get<int64_t>();
+    snap.cpu.usage = in.get<float>();
+    snap.cpu.sampled = in.get<uint8_t>();
+    snap.sensors.temperature = in.get<float>();
+    snap.sensors.fanRPM = in.get<int32_t>();
+    snap.battery.capacity = in.get<int32_t>();
+    snap.battery.status = in.getString();
+    snap.battery.available = in.get<uint8_t>();
+
+    uint32_t count = in.get<uint32_t>();
+    vector<DiskInfo> disks;
+    disks.reserve(in.plausibleCount(count, 20));
+    for (uint32_t i = 0; i < count && in.ok(); ++i) {
+        DiskInfo disk;
+        disk.mountpoint = in.getString();
+        disk.totalBytes = in.get<uint64_t>();
+        disk.usedBytes = in.get<uint64_t>();
+        disks.push_back(move(disk));
+    }
+    snap.disks = move(disks);
+
+    snap.diskIO.readRate = in.get<double>();
+    snap.diskIO.writeRate = in.get<double>();
+    snap.diskIO.sampled = in.get<uint8_t>();
+    snap.network.rxRate = in.get<double>();
+    snap.network.txRate = in.get<double>();
+    snap.network.sampled = in.get<uint8_t>();
+    count = in.get<uint32_t>();
+    vector<NetInterfaceInfo> interfaces;
+    interfaces.reserve(in.plausibleCount(count, 36));
+    for (uint32_t i = 0; i < count && in.ok(); ++i) {
+        NetInterfaceInfo iface;
+        iface.name = in.getString();
+        iface.rxBytes = in.get<int64_t>();
+        iface.txBytes = in.get<int64_t>();
+        iface.rxRate = in.get<double>();
+        iface.txRate = in.get<double>();
+        interfaces.push_back(move(iface));
+    }
+    snap.network.interfaces = move(interfaces);
+    snap.wifiSignal = in.getString();
+
+    HzSnapshot& burst = snap.burst;
+    burst.hz = in.get<int32_t>();
+    burst.cpu = in.get<uint8_t>();
+    burst.network = in.get<uint8_t>();
+    burst.samples = in.get<uint64_t>();
+    burst.dropped = in.get<uint64_t>();
+    for (BurstStats* stats : { &burst.cpuUsage, &burst.rxRate, &burst.txRate }) {
+        stats->min = in.get<double>();
+        stats->avg = in.get<double>();
+        stats->max = in.get<double>();
+    }
+    return in.ok() && in.done();
+}
+
+/**
+ * @brief Fills @p addr with the Unix socket address of @p path.
+ *
+ * @return false if the path does not fit.
+ */
+bool unixAddress(const string& path, sockaddr_un& addr) {
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/**
+ * @brief Connects to the Unix stream socket at @p path.
+ *
+ * @return The connected, non-blocking descriptor, or -1 if nobody is listening.
+ */
+int connectUnix(const string& path) {
+    sockaddr_un addr;
+    if (!unixAddress(path, addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @brief Whether the process at the other end of @p fd runs as this user or as root.
+ *
+ * Only such a termistatd is trusted to feed the viewer.
+ *
+ * @param[out] uid User the peer runs as.
+ */
+bool trustedPeer(int fd, uid_t& uid) {
+    ucred cred{};
+    socklen_t size = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) != 0)
+        return false;
+    uid = cred.uid;
+    return cred.uid == getuid() || cred.uid == 0;
+}
+
+/**
+ * @brief Destination that snapshots are published to once per tick.
+ *
+ * Exporters that serve clients also hand their descriptors to the loop's
+ * poll() through watch() and handle(), so one thread serves everything
+ * between ticks.
+ */
+class Exporter {
+public:
+    virtual ~Exporter() = default;
+
+    /// Empty once the exporter is ready, otherwise why it could not be set up.
+    const string& error() const { return error_; }
+
+    /**
+     * @brief Publishes the snapshot of this tick.
+     */
+    virtual void publish(const Snapshot& snap) = 0;
+
+    /**
+     * @brief Appends the descriptors to wait on until the next tick.
+     *
+     * @return How many were appended; handle() receives the same entries.
+     */
+    virtual size_t watch(vector<pollfd>&) { return 0; }
+
+    /**
+     * @brief Handles the poll() results of the entries appended by watch().
+     */
+    virtual void handle(const pollfd*) {}
+
+protected:
+    string error_;
+};
+
+/**
+ * @brief Polls @p fds together with the descriptors of every exporter.
+ *
+ * The exporters handle their own entries before this returns; @p fds is
+ * left holding the caller's entries first, with their results.
+ *
+ * @return poll()'s result.
+ */
+int pollWithExporters(vector<pollfd>& fds, const vector<unique_ptr<Exporter>>& exporters,
+                      chrono::milliseconds timeout) {
+    static vector<size_t> watched;
+    size_t own = fds.size();
+    watched.resize(exporters.size());
+    for (size_t i = 0; i < exporters.size(); ++i)
+        watched[i] = exporters[i]->watch(fds);
+    int ready = poll(fds.data(), fds.size(), int(max<int64_t>(0, timeout.count())));
+    if (ready > 0) {
+        size_t at = own;
+        for (size_t i = 0; i < exporters.size(); ++i) {
+            if (watched[i] > 0)
+                exporters[i]->handle(fds.data() + at);
+            at += watched[i];
+        }
+    }
+    fds.resize(own);
+    return ready;
+}
+
+/**
+ * @brief Listening side of termistatd: hands each published frame to every viewer.
+ *
+ * A frame is encoded once and shared by all viewers. Viewers still
+ * draining an older frame skip the new one, so a stalled viewer costs at
+ * most one buffered frame and never delays the others.
+ */
+class SnapshotServer : public Exporter {
+public:
+    /**
+     * @brief Listens on @p path, replacing a stale socket left by a daemon that died.
+     *
+     * The socket is created with mode 0660, so only the daemon's user and
+     * group can attach.
+     */
+    explicit SnapshotServer(const string& path) : path_(path) {
+        sockaddr_un addr;
+        if (!unixAddress(path, addr)) {
+            error_ = "socket path is empty or too long: " + path;
+            return;
+        }
+        struct stat existing;
+        if (lstat(path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                error_ = path + " exists and is not a socket";
+                return;
+            }
+            int other = connectUnix(path);
+            if (other >= 0) {
+                close(other);
+                error_ = "another termistatd is already serving " + path;
+                return;
+            }
+            unlink(path.c_str());
+        }
+
+        listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        mode_t mask = umask(0117); // bind() creates the socket 0660, with no window where others can connect
+        bool bound = listener_ >= 0 && bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        umask(mask);
+        if (!bound) {
+            error_ = "cannot bind " + path + ": " + strerror(errno);
+            return;
+        }
+        bound_ = true;
+        if (listen(listener_, 16) != 0)
+            error_ = "cannot listen on " + path + ": " + strerror(errno);
+    }
+
+    ~SnapshotServer() override {
+        for (Viewer& viewer : viewers_)
+            close(viewer.fd);
+        if (listener_ >= 0)
+            close(listener_);
+        if (bound_)
+            unlink(path_.c_str());
+    }
+
+    SnapshotServer(const SnapshotServer&) = delete;
+    SnapshotServer& operator=(const SnapshotServer&) = delete;
+
+    /**
+     * @brief Encodes @p snap and starts sending it to every viewer that has taken the previous frame.
+     */
+    void publish(const Snapshot& snap) override {
+        auto frame = make_shared<string>();
+        encodeSnapshotFrame(snap, *frame);
+        latest_ = move(frame);
+        for (Viewer& viewer : viewers_) {
+            if (viewer.frame)
+                continue; // still sending an older frame
+            viewer.frame = latest_;
+            viewer.sent = 0;
+        }
+        flushAll();
+    }
+
+    size_t watch(vector<pollfd>& fds) override {
+        fds.push_back({ listener_, POLLIN, 0 });
+        for (const Viewer& viewer : viewers_)
+            fds.push_back({ viewer.fd, short(POLLIN | (viewer.frame ? POLLOUT : 0)), 0 });
+        return 1 + viewers_.size();
+    }
+
+    /**
+     * @brief Accepts new viewers, drops those that left and sends more to those that can take it.
+     */
+    void handle(const pollfd* fds) override {
+        // Viewers never send anything; readable means they hung up
+        for (size_t i = viewers_.size(); i-- > 0; ) {
+            short events = fds[i + 1].revents;
+            if (events & (POLLIN | POLLHUP | POLLERR)) {
+                char discard[256];
+                if (read(viewers_[i].fd, discard, sizeof(discard)) <= 0)
+                    drop(i);
+            }
+        }
+        flushAll();
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                viewers_.push_back({ fd, latest_, 0 });
+                flush(viewers_.back());
+            }
+        }
+    }
+
+private:
+    struct Viewer {
+        int fd;
+        shared_ptr<const string> frame;     ///< Frame being sent, null when idle
+        size_t sent;                        ///< Bytes of it already sent
+    };
+
+    /**
+     * @brief Sends as much of the viewer's frame as the socket takes.
+     *
+     * @return false if the viewer is gone.
+     */
+    bool flush(Viewer& viewer) {
+        while (viewer.frame) {
+            ssize_t n = send(viewer.fd, viewer.frame->data() + viewer.sent, viewer.frame->size() - viewer.sent,
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            viewer.sent += n;
+            if (viewer.sent == viewer.frame->size())
+                viewer.frame.reset();
+        }
+        return true;
+    }
+
+    void flushAll() {
+        for (size_t i = viewers_.size(); i-- > 0; )
+            if (!flush(viewers_[i]))
+                drop(i);
+    }
+
+    void drop(size_t index) {
+        close(viewers_[index].fd);
+        viewers_.erase(viewers_.begin() + index);
+    }
+
+    string path_;
+    int listener_ = -1;
+    bool bound_ = false;
+    vector<Viewer> viewers_;
+    shared_ptr<const string> latest_;   ///< Sent to viewers as soon as they connect
+};
+
+/**
+ * @brief Viewer side of termistatd: receives frames and keeps the newest snapshot.
+ */
+class SnapshotClient {
+public:
+    /**
+     * @param fd Connected socket, see connectUnix(); owned from now on.
+     */
+    explicit SnapshotClient(int fd) : fd_(fd) {}
+    ~SnapshotClient() { close(fd_); }
+    SnapshotClient(const SnapshotClient&) = delete;
+    SnapshotClient& operator=(const SnapshotClient&) = delete;
+
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Reads what has arrived and decodes the newest complete frame.
+     *
+     * Frames that were overtaken by a newer one in the same read are
+     * skipped without decoding.
+     *
+     * @return false once the daemon has gone away or sent something unreadable.
+     */
+    bool receive() {
+        char chunk[65536];
+        while (true) {
+            ssize_t n = read(fd_, chunk, sizeof(chunk));
+            if (n > 0) {
+                buffer_.append(chunk, n);
+                continue;
+            }
+            if (n == 0)
+                return false;
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            break;
+        }
+
+        size_t offset = 0, newest = string::npos;
+        uint32_t size = 0;
+        while (buffer_.size() - offset >= sizeof(uint32_t)) {
+            uint32_t frame;
+            memcpy(&frame, buffer_.data() + offset, sizeof(frame));
+            if (frame > MaxSnapshotFrame)
+                return false;
+            if (buffer_.size() - offset - sizeof(uint32_t) < frame)
+                break;
+            newest = offset + sizeof(uint32_t);
+            size = frame;
+            offset = newest + frame;
+        }
+        if (newest != string::npos) {
+            if (!decodeSnapshot(string_view(buffer_).substr(newest, size), latest_))
+                return false;
+            latest_.time = Clock::now();
+        }
+        buffer_.erase(0, offset);
+        return true;
+    }
+
+    /// Newest snapshot received, empty until the first frame arrives.
+    const Snapshot& latest() const { return latest_; }
+
+    /// Whether a frame has arrived yet.
+    bool received() const { return latest_.time != Clock::time_point(); }
+
+private:
+    int fd_;
+    string buffer_;
+    Snapshot latest_;
+};
+
+/**
+ * @brief Publishes snapshots into the shared-memory segment laid out in termistat_shm.h.
+ *
+ * Only one process publishes at a time; the segment is locked with flock()
+ * and removed again when the publisher exits. A segment that another user
+ * owns, or that others may write, is refused: whoever can open it could
+ * block publishing, shrink it under the writer or forge the metrics.
+ */
+class SharedMetrics : public Exporter {
+public:
+    SharedMetrics() {
+        fd_ = shm_open(TERMISTAT_SHM_NAME, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            error_ = string("cannot open shared memory ") + TERMISTAT_SHM_NAME + ": " + strerror(errno);
+            return;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+            error_ = string("refusing shared memory ") + TERMISTAT_SHM_NAME
+                     + ": it is owned by another user or writable by others";
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+        if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+            error_ = string("another termistat is already publishing ") + TERMISTAT_SHM_NAME;
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+        void* mapping = MAP_FAILED;
+        if (ftruncate(fd_, sizeof(termistat_shm)) == 0)
+            mapping = mmap(nullptr, sizeof(termistat_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            error_ = string("cannot map shared memory ") + TERMISTAT_SHM_NAME + ": " + strerror(errno);
+            return;
+        }
+        shm_ = static_cast<termistat_shm*>(mapping);
+
+        // A segment left behind by an earlier writer may hold another layout
+        shm_->magic = 0;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        uint64_t sequence = (shm_->sequence + 1) & ~uint64_t(1);
+        memset(static_cast<void*>(shm_), 0, sizeof(termistat_shm));
+        shm_->version = TERMISTAT_SHM_VERSION;
+        shm_->size = sizeof(termistat_shm);
+        shm_->writer_pid = uint32_t(getpid());
+        shm_->sequence = sequence;
+        __atomic_store_n(&shm_->magic, TERMISTAT_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    ~SharedMetrics() override {
+        if (shm_) {
+            munmap(shm_, sizeof(termistat_shm));
+            shm_unlink(TERMISTAT_SHM_NAME);
+        }
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    SharedMetrics(const SharedMetrics&) = delete;
+    SharedMetrics& operator=(const SharedMetrics&) = delete;
+
+    /**
+     * @brief Writes @p snap into the segment under the seqlock.
+     */
+    void publish(const Snapshot& snap) override {
+        uint64_t sequence = shm_->sequence;
+        __atomic_store_n(&shm_->sequence, sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        shm_->updated_ns = uint64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+        ++shm_->updates;
+        shm_->mem_total_kb = snap.memory.totalKB;
+        shm_->mem_available_kb = snap.memory.availableKB;
+        shm_->cpu_usage = snap.cpu.usage;
+        shm_->temperature_c = snap.sensors.temperature;
+        shm_->fan_rpm = snap.sensors.fanRPM;
+        shm_->battery_capacity = snap.battery.available ? snap.battery.capacity : -1;
+        copyName(shm_->battery_status, snap.battery.available ? snap.battery.status : string());
+        shm_->disk_read_rate = snap.diskIO.readRate;
+        shm_->disk_write_rate = snap.diskIO.writeRate;
+        shm_->net_rx_rate = snap.network.rxRate;
+        shm_->net_tx_rate = snap.network.txRate;
+
+        shm_->disk_count = uint32_t(snap.disks.size());
+        size_t disks = min<size_t>(snap.disks.size(), TERMISTAT_SHM_MAX_DISKS);
+        for (size_t i = 0; i < disks; ++i) {
+            termistat_shm_disk& disk = shm_->disks[i];
+            copyName(disk.mountpoint, snap.disks[i].mountpoint);
+            disk.total_bytes = snap.disks[i].totalBytes;
+            disk.used_bytes = snap.disks[i].usedBytes;
+        }
+        shm_->interface_count = uint32_t(snap.network.interfaces.size());
+        size_t interfaces = min<size_t>(snap.network.interfaces.size(), TERMISTAT_SHM_MAX_INTERFACES);
+        for (size_t i = 0; i < interfaces; ++i) {
+            const NetInterfaceInfo& from = snap.network.interfaces[i];
+            termistat_shm_interface& iface = shm_->interfaces[i];
+            copyName(iface.name, from.name);
+            iface.rx_bytes = from.rxBytes;
+            iface.tx_bytes = from.txBytes;
+            iface.rx_rate = from.rxRate;
+            iface.tx_rate = from.txRate;
+        }
+
+        __atomic_store_n(&shm_->sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+private:
+    /// Copies @p from into a fixed-size field, truncated and NUL-padded.
+    template <size_t Size>
+    static void copyName(char (&to)[Size], const string& from) {
+        size_t n = min(from.size(), Size - 1);
+        memcpy(to, from.data(), n);
+        memset(to + n, 0, Size - n);
+    }
+
+    int fd_ = -1;
+    termistat_shm* shm_ = nullptr;
+};
+
+/**
+ * @brief Appends the shortest text that reads back as @p value.
+ */
+void appendNumber(string& out, double value) {
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+/**
+ * @brief Appends the shortest text that reads back as the float @p value.
+ *
+ * Widening to double first would print the float's binary error, such as
+ * 9.090909004211426 for 9.090909.
+ */
+void appendNumber(string& out, float value) {
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+/**
+ * @brief Appends @p value in decimal.
+ */
+void appendNumber(string& out, long long value) {
+    char buffer[24];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+/**
+ * @brief Appends the HELP and TYPE lines that introduce a metric family.
+ */
+void appendMetricFamily(string& out, string_view name, string_view type, string_view help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+/**
+ * @brief Appends one sample, optionally with a single label.
+ *
+ * Label values are escaped as the text format requires.
+ */
+void appendSample(string& out, string_view name, double value, string_view label = {}, string_view labelValue = {}) {
+    out += name;
+    if (!label.empty()) {
+        out.append("{").append(label).append("=\"");
+        for (char c : labelValue) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') { out += "\\n"; continue; }
+            out += c;
+        }
+        out += "\"}";
+    }
+    out += ' ';
+    if (isnan(value)) {
+        out += "NaN";
+    } else if (isinf(value)) {
+        out += value > 0 ? "+Inf" : "-Inf";
+    } else {
+        appendNumber(out, value);
+    }
+    out += '\n';
+}
+
+/**
+ * @brief The first entry of every mountpoint in @p disks, in list order.
+ *
+ * Stacked and bind mounts list a mountpoint more than once, and statvfs
+ * sees the same filesystem for all of them. The disk list is only
+ * replaced every 30 s, so the result is kept until it is; building it
+ * sorts pointers, O(n log n) and free of allocations once the buffers
+ * have grown.
+ */
+const vector<const DiskInfo*>& firstMountpoints(const SharedList<DiskInfo>& disks) {
+    static SharedList<DiskInfo> listed;     // holds the list, so its address cannot be reused
+    static vector<const DiskInfo*> sorted, first;
+    if (&disks.items() == &listed.items())
+        return first;
+    listed = disks;
+    sorted.clear();
+    for (const DiskInfo& disk : disks)
+        sorted.push_back(&disk);
+    // Equal mountpoints stay in list order, so the first of each run is the earliest
+    sort(sorted.begin(), sorted.end(), [](const DiskInfo* a, const DiskInfo* b) {
+        int order = a->mountpoint.compare(b->mountpoint);
+        return order != 0 ? order < 0 : a < b;
+    });
+    first.clear();
+    for (size_t i = 0; i < sorted.size(); ++i)
+        if (i == 0 || sorted[i]->mountpoint != sorted[i - 1]->mountpoint)
+            first.push_back(sorted[i]);
+    sort(first.begin(), first.end());
+    return first;
+}
+
+/**
+ * @brief Renders @p snap in the Prometheus text exposition format (version 0.0.4).
+ *
+ * Readings that are unavailable on this host, such as a missing fan or
+ * battery, are left out rather than exported as -1.
+ */
+void writePrometheusMetrics(const Snapshot& snap, string& out) {
+    out.clear();
+    appendMetricFamily(out, "termistat_memory_total_bytes", "gauge", "Total usable memory.");
+    appendSample(out, "termistat_memory_total_bytes", snap.memory.totalKB * 1024.0);
+    appendMetricFamily(out, "termistat_memory_available_bytes", "gauge", "Memory available for new allocations.");
+    appendSample(out, "termistat_memory_available_bytes", snap.memory.availableKB * 1024.0);
+
+    appendMetricFamily(out, "termistat_cpu_usage_ratio", "gauge", "Share of CPU time not spent idle, 0 to 1.");
+    appendSample(out, "termistat_cpu_usage_ratio", snap.cpu.usage / 100.0);
+    if (snap.sensors.temperature > 0) {
+        appendMetricFamily(out, "termistat_cpu_temperature_celsius", "gauge", "Temperature of thermal zone 0.");
+        appendSample(out, "termistat_cpu_temperature_celsius", snap.sensors.temperature);
+    }
+    if (snap.sensors.fanRPM > 0) {
+        appendMetricFamily(out, "termistat_fan_speed_rpm", "gauge", "Speed of the first fan reported by hwmon.");
+        appendSample(out, "termistat_fan_speed_rpm", snap.sensors.fanRPM);
+    }
+    if (snap.battery.available) {
+        appendMetricFamily(out, "termistat_battery_capacity_ratio", "gauge", "Battery charge, 0 to 1.");
+        appendSample(out, "termistat_battery_capacity_ratio", snap.battery.capacity / 100.0, "status",
+                     snap.battery.status);
+    }
+
+    appendMetricFamily(out, "termistat_disk_read_bytes_per_second", "gauge", "Read throughput of whole disks.");
+    appendSample(out, "termistat_disk_read_bytes_per_second", snap.diskIO.readRate);
+    appendMetricFamily(out, "termistat_disk_written_bytes_per_second", "gauge", "Write throughput of whole disks.");
+    appendSample(out, "termistat_disk_written_bytes_per_second", snap.diskIO.writeRate);
+
+    // A repeated mountpoint would repeat a series with identical labels
+    const vector<const DiskInfo*>& disks = firstMountpoints(snap.disks);
+    appendMetricFamily(out, "termistat_filesystem_size_bytes", "gauge", "Size of the mounted filesystem.");
+    for (const DiskInfo* disk : disks)
+        appendSample(out, "termistat_filesystem_size_bytes", disk->totalBytes, "mountpoint", disk->mountpoint);
+    appendMetricFamily(out, "termistat_filesystem_used_bytes", "gauge", "Space used on the mounted filesystem.");
+    for (const DiskInfo* disk : disks)
+        appendSample(out, "termistat_filesystem_used_bytes", disk->usedBytes, "mountpoint", disk->mountpoint);
+
+    appendMetricFamily(out, "termistat_network_receive_bytes_per_second", "gauge",
+                       "Receive rate summed over all interfaces but lo.");
+    appendSample(out, "termistat_network_receive_bytes_per_second", snap.network.rxRate);
+    appendMetricFamily(out, "termistat_network_transmit_bytes_per_second", "gauge",
+                       "Transmit rate summed over all interfaces but lo.");
+    appendSample(out, "termistat_network_transmit_bytes_per_second", snap.network.txRate);
+    appendMetricFamily(out, "termistat_network_receive_bytes_total", "counter", "Bytes received since boot.");
+    for (const NetInterfaceInfo& iface : snap.network.interfaces)
+        appendSample(out, "termistat_network_receive_bytes_total", iface.rxBytes, "interface", iface.name);
+    appendMetricFamily(out, "termistat_network_transmit_bytes_total", "counter", "Bytes transmitted since boot.");
+    for (const NetInterfaceInfo& iface : snap.network.interfaces)
+        appendSample(out, "termistat_network_transmit_bytes_total", iface.txBytes, "interface", iface.name);
+}
+
+/**
+ * @brief Minimal HTTP/1.1 server answering GET /metrics for Prometheus.
+ *
+ * The whole response, headers included, is rendered once per tick into a
+ * shared buffer; a scrape only sends bytes from it, so scrapes cost no
+ * formatting and no copies however often they come. A scrape in progress
+ * keeps the buffer it started with. Connections are kept alive between
+ * scrapes unless the client asks otherwise.
+ */
+class MetricsServer : public Exporter {
+public:
+    static constexpr size_t MaxConnections = 64;
+    static constexpr size_t MaxRequest = 8192;              ///< Bytes of request line and headers
+    static constexpr chrono::seconds IdleTimeout{30};
+
+    /**
+     * @param address "HOST:PORT", "[IPV6]:PORT" or ":PORT" for every interface.
+     */
+    explicit MetricsServer(const string& address) {
+        size_t colon = address.rfind(':');
+        if (colon == string::npos) {
+            error_ = "--listen expects HOST:PORT, got " + address;
+            return;
+        }
+        string host = address.substr(0, colon), port = address.substr(colon + 1);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+            host = host.substr(1, host.size() - 2);
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+        addrinfo* found = nullptr;
+        if (int rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found); rc != 0) {
+            error_ = "cannot resolve " + address + ": " + gai_strerror(rc);
+            return;
+        }
+        // Without a host, try a dual-stack IPv6 socket first so both families are served
+        for (bool ipv6 : { host.empty(), false }) {
+            for (addrinfo* ai = found; ai && listener_ < 0; ai = ai->ai_next) {
+                if (ipv6 && ai->ai_family != AF_INET6)
+                    continue;
+                int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+                if (fd < 0) continue;
+                int on = 1, off = 0;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+                if (ipv6)
+                    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+                if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 16) == 0)
+                    listener_ = fd;
+                else
+                    close(fd);
+            }
+        }
+        freeaddrinfo(found);
+        if (listener_ < 0)
+            error_ = "cannot listen on " + address + ": " + strerror(errno);
+    }
+
+    ~MetricsServer() override {
+        for (Connection& connection : connections_)
+            close(connection.fd);
+        if (listener_ >= 0)
+            close(listener_);
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Renders the response that scrapes get until the next tick.
+     */
+    void publish(const Snapshot& snap) override {
+        writePrometheusMetrics(snap, body_);
+        auto response = make_shared<string>();
+        response->reserve(body_.size() + 128);
+        *response += "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ";
+        *response += to_string(body_.size());
+        *response += "\r\n\r\n";
+        headerSize_ = response->size();
+        *response += body_;
+        metrics_ = move(response);
+    }
+
+    size_t watch(vector<pollfd>& fds) override {
+        // Drop connections that have been idle too long before waiting on them again
+        Clock::time_point now = Clock::now();
+        for (size_t i = connections_.size(); i-- > 0; )
+            if (!connections_[i].response && now - connections_[i].lastActive > IdleTimeout)
+                drop(i);
+
+        fds.push_back({ listener_, POLLIN, 0 });
+        for (const Connection& connection : connections_)
+            fds.push_back({ connection.fd, short(connection.response ? POLLOUT : POLLIN), 0 });
+        return 1 + connections_.size();
+    }
+
+    void handle(const pollfd* fds) override {
+        for (size_t i = connections_.size(); i-- > 0; ) {
+            short events = fds[i + 1].revents;
+            if (events && !serve(connections_[i], events))
+                drop(i);
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                if (connections_.size() >= MaxConnections) {
+                    close(fd);
+                    continue;
+                }
+                connections_.push_back({ fd, {}, nullptr, 0, 0, false, Clock::now() });
+            }
+        }
+    }
+
+private:
+    struct Connection {
+        int fd;
+        string request;                     ///< Bytes received and not yet answered
+        shared_ptr<const string> response;  ///< Response being sent, null while reading
+        size_t sent;                        ///< Bytes of it already sent
+        size_t length;                      ///< Bytes of it to send (the headers only for HEAD)
+        bool closeAfter;                    ///< Close once the response is sent
+        Clock::time_point lastActive;
+    };
+
+    /// Fixed response with @p status and a one-line body, built once.
+    static shared_ptr<const string> fixedResponse(string_view status, string_view body) {
+        auto response = make_shared<string>("HTTP/1.1 ");
+        response->append(status).append("\r\nContent-Type: text/plain\r\nContent-Length: ");
+        response->append(to_string(body.size() + 1)).append("\r\n\r\n").append(body).append("\n");
+        return response;
+    }
+
+    /**
+     * @brief Reads, answers or sends more on one connection.
+     *
+     * @return false once the connection should be closed.
+     */
+    bool serve(Connection& connection, short events) {
+        connection.lastActive = Clock::now();
+        if (events & (POLLERR | POLLNVAL))
+            return false;
+
+        if (!connection.response) {
+            char chunk[4096];
+            ssize_t n = read(connection.fd, chunk, sizeof(chunk));
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                return false;
+            if (n > 0)
+                connection.request.append(chunk, n);
+            if (!answer(connection))
+                return connection.request.size() <= MaxRequest;
+        }
+
+        while (connection.sent < connection.length) {
+            ssize_t n = send(connection.fd, connection.response->data() + connection.sent,
+                             connection.length - connection.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            connection.sent += n;
+        }
+        connection.response.reset();
+        if (connection.closeAfter)
+            return false;
+        return !answer(connection) || serve(connection, 0); // a pipelined request may be waiting
+    }
+
+    /**
+     * @brief Picks the response to the first complete request in the buffer.
+     *
+     * @return false if no complete request has arrived yet.
+     */
+    bool answer(Connection& connection) {
+        size_t end = connection.request.find("\r\n\r\n");
+        if (end == string::npos) {
+            if (connection.request.size() > MaxRequest) {
+                static const auto tooLarge = fixedResponse("431 Request Header Fields Too Large", "request too large");
+                respond(connection, tooLarge, tooLarge->size(), true);
+                connection.request.clear();
+                return true;
+            }
+            return false;
+        }
+        string_view request = string_view(connection.request).substr(0, end);
+        string_view line = request.substr(0, request.find("\r\n"));
+        string_view method = line.substr(0, line.find(' '));
+        string_view target = line.substr(min(line.size(), method.size() + 1));
+        string_view version = target.substr(min(target.size(), target.find(' ') + 1));
+        target = target.substr(0, target.find(' '));
+        target = target.substr(0, target.find('?'));
+
+        // HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 closes it unless told otherwise
+        string lower(request);
+        transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(tolower(c)); });
+        bool close = version == "HTTP/1.0" ? lower.find("connection: keep-alive") == string::npos
+                                           : lower.find("connection: close") != string::npos;
+
+        static const auto notFound = fixedResponse("404 Not Found", "metrics are served at /metrics");
+        static const auto notAllowed = fixedResponse("405 Method Not Allowed", "only GET and HEAD are supported");
+        static const auto unavailable = fixedResponse("503 Service Unavailable", "no snapshot collected yet");
+        bool head = method == "HEAD";
+        if (method != "GET" && !head)
+            respond(connection, notAllowed, notAllowed->size(), true);
+        else if (target != "/metrics")
+            respond(connection, notFound, head ? notFound->find("\r\n\r\n") + 4 : notFound->size(), close);
+        else if (!metrics_)
+            respond(connection, unavailable, unavailable->size(), close);
+        else
+            respond(connection, metrics_, head ? headerSize_ : metrics_->size(), close);
+        connection.request.erase(0, end + 4);
+        return true;
+    }
+
+    static void respond(Connection& connection, shared_ptr<const string> response, size_t length, bool close) {
+        connection.response = move(response);
+        connection.sent = 0;
+        connection.length = length;
+        connection.closeAfter = close;
+    }
+
+    void drop(size_t index) {
+        close(connections_[index].fd);
+        connections_.erase(connections_.begin() + index);
+    }
+
+    int listener_ = -1;
+    vector<Connection> connections_;
+    string body_;                       ///< Exposition text, reused between ticks
+    shared_ptr<const string> metrics_;  ///< Full /metrics response of the latest tick
+    size_t headerSize_ = 0;             ///< Bytes of metrics_ before the body, sent for HEAD
+};
+
+/**
+ * @brief Writes the metrics into a file for node_exporter's textfile collector.
+ *
+ * The exposition is rendered every tick but the file is only rewritten
+ * when a series appears or disappears, a counter changes, a gauge moves
+ * by more than epsilon times the largest magnitude it has had, or MaxAge
+ * has passed, which keeps writes rare on hosts with slow storage.
+ * Measuring gauges against their largest magnitude rather than the last
+ * value keeps those that idle around 0, like rates, from rewriting the
+ * file on every tick; counters are never held back, so rate() over them
+ * stays smooth, and MaxAge keeps the file's mtime a liveness signal.
+ * Each rewrite goes to a temporary file renamed over the old one, so
+ * node_exporter never reads a half-written file. The file is removed on
+ * exit, so stale metrics do not outlive termistat.
+ */
+class TextfileExporter : public Exporter {
+public:
+    static constexpr chrono::seconds MaxAge{60};    ///< Longest time between rewrites
+
+    /**
+     * @param dir Directory node_exporter reads with --collector.textfile.directory.
+     * @param epsilon Relative change of a gauge that triggers a rewrite; 0 rewrites on any change.
+     */
+    TextfileExporter(const string& dir, double epsilon)
+        : path_(dir + "/termistat.prom"), temp_(path_ + ".tmp"), epsilon_(epsilon) {
+        if (access(dir.c_str(), W_OK) != 0)
+            error_ = "cannot write to " + dir + ": " + strerror(errno);
+    }
+
+    ~TextfileExporter() override {
+        if (written_)
+            unlink(path_.c_str());
+    }
+
+    void publish(const Snapshot& snap) override {
+        writePrometheusMetrics(snap, text_);
+        splitSamples(text_, series_, values_, counters_);
+        if (series_ != writtenSeries_)
+            scales_.assign(values_.size(), 0.0);
+        for (size_t i = 0; i < values_.size(); ++i)
+            if (isfinite(values_[i]))
+                scales_[i] = max(scales_[i], fabs(values_[i]));
+        Clock::time_point now = Clock::now();
+        if (written_ && series_ == writtenSeries_ && now - writtenAt_ < MaxAge && !changed(values_, writtenValues_))
+            return;
+        if (!write())
+            return; // the previous file stays; tried again next tick
+        written_ = true;
+        writtenAt_ = now;
+        writtenSeries_.swap(series_);
+        writtenValues_.swap(values_);
+    }
+
+private:
+    /**
+     * @brief Separates the sample values of @p text from everything else.
+     *
+     * @p series receives the text without the values, so two expositions
+     * have the same series exactly when it is equal.
+     *
+     * @param[out] counters Whether each value belongs to a counter family.
+     */
+    static void splitSamples(string_view text, string& series, vector<double>& values, vector<char>& counters) {
+        series.clear();
+        values.clear();
+        counters.clear();
+        bool counter = false;
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            string_view line = text.substr(0, end);
+            text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+            size_t space = line.rfind(' ');
+            if (line.empty() || line[0] == '#' || space == string_view::npos) {
+                if (line.substr(0, 7) == "# TYPE ")
+                    counter = line.substr(space + 1) == "counter";
+                series.append(line).append("\n");
+                continue;
+            }
+            counters.push_back(counter);
+            series.append(line.substr(0, space)).append("\n");
+            string_view number = line.substr(space + 1);
+            double value = NAN;
+            if (number == "+Inf" || number == "-Inf")
+                value = number[0] == '+' ? INFINITY : -INFINITY;
+            else
+                from_chars(number.data(), number.data() + number.size(), value);
+            values.push_back(value);
+        }
+    }
+
+    /**
+     * @brief Whether any counter changed or any gauge moved by more than epsilon relative to its largest magnitude.
+     */
+    bool changed(const vector<double>& now, const vector<double>& before) const {
+        for (size_t i = 0; i < now.size(); ++i) {
+            double a = now[i], b = before[i];
+            if (isnan(a) || isnan(b) || isinf(a) || isinf(b)) {
+                if (!(isnan(a) && isnan(b)) && a != b)
+                    return true;
+                continue;
+            }
+            if (counters_[i] ? a != b : fabs(a - b) > epsilon_ * scales_[i])
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Writes text_ to the temporary file and renames it into place.
+     */
+    bool write() const {
+        int fd = open(temp_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+        size_t done = 0;
+        while (done < text_.size()) {
+            ssize_t n = ::write(fd, text_.data() + done, text_.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        bool ok = close(fd) == 0 && done == text_.size();
+        if (ok && rename(temp_.c_str(), path_.c_str()) == 0)
+            return true;
+        unlink(temp_.c_str());
+        return false;
+    }
+
+    string path_;                   ///< DIR/termistat.prom
+    string temp_;                   ///< Written first, then renamed to path_
+    double epsilon_;
+    string text_;                   ///< Exposition of the latest tick
+    string series_;                 ///< text_ without its values
+    vector<double> values_;         ///< Values of text_, in order
+    vector<double> scales_;         ///< Largest magnitude of each value since the series last changed
+    vector<char> counters_;         ///< Whether each value of text_ is a counter
+    bool written_ = false;          ///< path_ holds a file written by this process
+    Clock::time_point writtenAt_;   ///< When path_ was last written
+    string writtenSeries_;          ///< series_ of the file on disk
+    vector<double> writtenValues_;  ///< values_ of the file on disk
+};
+
+/**
+ * @brief Record format of the headless --format modes.
+ */
+enum class OutputFormat { Terminal, JsonLines, Csv };
+
+/**
+ * @brief Appends @p text as a JSON string literal.
+ */
+void appendJsonString(string& out, string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char byte = c;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20) {
+            out += "\\u00";
+            out += hex[byte >> 4];
+            out += hex[byte & 15];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief Appends @p value as a JSON number, or null when JSON cannot represent it.
+ */
+template <typename Real>
+void appendJsonNumber(string& out, Real value) {
+    if (isfinite(value))
+        appendNumber(out, value);
+    else
+        out += "null";
+}
+
+/**
+ * @brief Appends "key":{"min":..,"avg":..,"max":..}.
+ *
+ * @tparam Real float for statistics of float samples, so they print as those do.
+ */
+template <typename Real = double>
+void appendJsonBurst(string& out, const char* key, const BurstStats& stats) {
+    out.append(",\"").append(key).append("\":{\"min\":");
+    appendJsonNumber(out, Real(stats.min));
+    out += ",\"avg\":";
+    appendJsonNumber(out, Real(stats.avg));
+    out += ",\"max\":";
+    appendJsonNumber(out, Real(stats.max));
+    out += '}';
+}
+
+/**
+ * @brief What --self-stats reports outside the terminal view.
+ */
+struct SelfStatsSource {
+    const SelfMonitor::Stats& stats;
+    const CollectorRegistry& collectors;    ///< Empty when the snapshots come from termistatd
+    const CostCounter& output;              ///< Time spent producing the output itself
+    const char* outputName;
+};
+
+/**
+ * @brief Appends "name":{"count":..,"last_ns":..,"p50_ns":..,"p99_ns":..,"max_ns":..}.
+ */
+void appendJsonCost(string& out, string_view name, const CostCounter& cost) {
+    const LatencyHistogram& h = cost.histogram;
+    appendJsonString(out, name);
+    out += ":{\"count\":";
+    appendNumber(out, (long long)h.count());
+    out += ",\"last_ns\":";
+    appendNumber(out, (long long)cost.lastNs.load(memory_order_relaxed));
+    out += ",\"p50_ns\":";
+    appendNumber(out, (long long)h.percentile(50));
+    out += ",\"p99_ns\":";
+    appendNumber(out, (long long)h.percentile(99));
+    out += ",\"max_ns\":";
+    appendNumber(out, (long long)h.max());
+    out += '}';
+}
+
+/**
+ * @brief Appends termistat's own cost as a JSON object: process figures per tick,
+ *        then the latency of every collector and of the output.
+ */
+void writeJsonSelfStats(const SelfStatsSource& self, string& out) {
+    out += "{\"cpu_ns_per_tick\":";
+    appendJsonNumber(out, self.stats.cpuNsPerFrame);
+    out += ",\"cpu_percent\":";
+    appendJsonNumber(out, self.stats.cpuPercent);
+    out += ",\"rss_bytes\":";
+    appendJsonNumber(out, self.stats.rssBytes);
+    out += ",\"read_write_calls_per_tick\":";
+    appendJsonNumber(out, self.stats.readWriteCallsPerFrame);
+    out += ",\"bytes_written_per_tick\":";
+    appendJsonNumber(out, self.stats.bytesPerFrame);
+    out += ",\"collectors\":{";
+    for (size_t i = 0; i < self.collectors.size(); ++i) {
+        if (i > 0)
+            out += ',';
+        appendJsonCost(out, self.collectors[i].name(), self.collectors[i].cost);
+    }
+    out += "},";
+    appendJsonCost(out, self.outputName, self.output);
+    out += '}';
+}
+
+/**
+ * @brief Appends @p snap as one JSON Lines record.
+ *
+ * Every key is always present so consumers see a fixed schema; readings
+ * the host does not have are null. "burst" is null unless --hz is on;
+ * "self" is only there with --self-stats.
+ *
+ * @param timeMs Wall-clock time of the record in milliseconds since the epoch.
+ * @param self termistat's own cost to include, or nullptr.
+ */
+void writeJsonRecord(const Snapshot& snap, long long timeMs, string& out, const SelfStatsSource* self = nullptr) {
+    out += "{\"time_ms\":";
+    appendNumber(out, timeMs);
+    out += ",\"memory\":{\"total_bytes\":";
+    appendNumber(out, snap.memory.totalKB * 1024LL);
+    out += ",\"available_bytes\":";
+    appendNumber(out, snap.memory.availableKB * 1024LL);
+    out += "},\"cpu_usage_percent\":";
+    appendJsonNumber(out, snap.cpu.usage);
+    out += ",\"temperature_celsius\":";
+    if (snap.sensors.temperature > 0)
+        appendJsonNumber(out, snap.sensors.temperature);
+    else
+        out += "null";
+    out += ",\"fan_rpm\":";
+    if (snap.sensors.fanRPM > 0)
+        appendNumber(out, (long long)snap.sensors.fanRPM);
+    else
+        out += "null";
+    out += ",\"battery\":";
+    if (snap.battery.available) {
+        out += "{\"capacity_percent\":";
+        appendNumber(out, (long long)snap.battery.capacity);
+        out += ",\"status\":";
+        appendJsonString(out, snap.battery.status);
+        out += '}';
+    } else {
+        out += "null";
+    }
+    out += ",\"disk_io\":{\"read_bytes_per_second\":";
+    appendJsonNumber(out, snap.diskIO.readRate);
+    out += ",\"write_bytes_per_second\":";
+    appendJsonNumber(out, snap.diskIO.writeRate);
+    out += "},\"network\":{\"rx_bytes_per_second\":";
+    appendJsonNumber(out, snap.network.rxRate);
+    out += ",\"tx_bytes_per_second\":";
+    appendJsonNumber(out, snap.network.txRate);
+    out += ",\"interfaces\":[";
+    bool first = true;
+    for (const NetInterfaceInfo& iface : snap.network.interfaces) {
+        out += first ? "{\"name\":" : ",{\"name\":";
+        first = false;
+        appendJsonString(out, iface.name);
+        out += ",\"rx_bytes\":";
+        appendNumber(out, iface.rxBytes);
+        out += ",\"tx_bytes\":";
+        appendNumber(out, iface.txBytes);
+        out += ",\"rx_bytes_per_second\":";
+        appendJsonNumber(out, iface.rxRate);
+        out += ",\"tx_bytes_per_second\":";
+        appendJsonNumber(out, iface.txRate);
+        out += '}';
+    }
+    out += "]},\"filesystems\":[";
+    first = true;
+    for (const DiskInfo& disk : snap.disks) {
+        out += first ? "{\"mountpoint\":" : ",{\"mountpoint\":";
+        first = false;
+        appendJsonString(out, disk.mountpoint);
+        out += ",\"size_bytes\":";
+        appendNumber(out, (long long)disk.totalBytes);
+        out += ",\"used_bytes\":";
+        appendNumber(out, (long long)disk.usedBytes);
+        out += '}';
+    }
+    out += "],\"burst\":";
+    if (snap.burst.hz > 0) {
+        out += "{\"hz\":";
+        appendNumber(out, (long long)snap.burst.hz);
+        out += ",\"samples\":";
+        appendNumber(out, (long long)snap.burst.samples);
+        out += ",\"dropped\":";
+        appendNumber(out, (long long)snap.burst.dropped);
+        if (snap.burst.cpu)
+            appendJsonBurst<float>(out, "cpu_usage_percent", snap.burst.cpuUsage);
+        if (snap.burst.network) {
+            appendJsonBurst(out, "rx_bytes_per_second", snap.burst.rxRate);
+            appendJsonBurst(out, "tx_bytes_per_second", snap.burst.txRate);
+        }
+        out += '}';
+    } else {
+        out += "null";
+    }
+    if (self) {
+        out += ",\"self\":";
+        writeJsonSelfStats(*self, out);
+    }
+    out += "}\n";
+}
+
+/**
+ * @brief Header line of --format csv; writeCsvRecord() fills the same columns.
+ *
+ * With --self-stats, termistat's own cost follows: CPU share, resident
+ * set, read/write calls per record, then the median and 99th percentile
+ * latency of each local collector and of writing the record.
+ */
+string csvHeader(const SelfStatsSource* self) {
+    string header =
+        "time_ms,memory_total_bytes,memory_available_bytes,cpu_usage_percent,temperature_celsius,fan_rpm,"
+        "battery_capacity_percent,battery_status,disk_read_bytes_per_second,disk_write_bytes_per_second,"
+        "network_rx_bytes_per_second,network_tx_bytes_per_second";
+    if (self) {
+        header += ",self_cpu_percent,self_rss_bytes,self_read_write_calls_per_tick";
+        for (size_t i = 0; i < self->collectors.size(); ++i) {
+            string name = self->collectors[i].name();
+            header += ",collector_" + name + "_p50_ns,collector_" + name + "_p99_ns";
+        }
+        header.append(",").append(self->outputName).append("_p50_ns,");
+        header.append(self->outputName).append("_p99_ns");
+    }
+    return header + "\n";
+}
+
+/**
+ * @brief Appends the scalar readings of @p snap as one CSV row matching csvHeader().
+ *
+ * Per-interface and per-filesystem lists do not fit fixed columns and are
+ * only in the JSON Lines records. Readings the host does not have are
+ * left empty.
+ */
+void writeCsvRecord(const Snapshot& snap, long long timeMs, string& out, const SelfStatsSource* self = nullptr) {
+    appendNumber(out, timeMs);
+    out += ',';
+    appendNumber(out, snap.memory.totalKB * 1024LL);
+    out += ',';
+    appendNumber(out, snap.memory.availableKB * 1024LL);
+    out += ',';
+    appendNumber(out, snap.cpu.usage);
+    out += ',';
+    if (snap.sensors.temperature > 0)
+        appendNumber(out, snap.sensors.temperature);
+    out += ',';
+    if (snap.sensors.fanRPM > 0)
+        appendNumber(out, (long long)snap.sensors.fanRPM);
+    out += ',';
+    if (snap.battery.available)
+        appendNumber(out, (long long)snap.battery.capacity);
+    out += ',';
+    if (snap.battery.available) {
+        // RFC 4180: quote fields holding separators, quotes or line breaks
+        const string& status = snap.battery.status;
+        if (status.find_first_of(",\"\r\n") == string::npos) {
+            out += status;
+        } else {
+            out += '"';
+            for (char c : status) {
+                if (c == '"') out += '"';
+                out += c;
+            }
+            out += '"';
+        }
+    }
+    out += ',';
+    appendNumber(out, snap.diskIO.readRate);
+    out += ',';
+    appendNumber(out, snap.diskIO.writeRate);
+    out += ',';
+    appendNumber(out, snap.network.rxRate);
+    out += ',';
+    appendNumber(out, snap.network.txRate);
+    if (self) {
+        out += ',';
+        appendNumber(out, self->stats.cpuPercent);
+        out += ',';
+        appendNumber(out, self->stats.rssBytes);
+        out += ',';
+        appendNumber(out, self->stats.readWriteCallsPerFrame);
+        auto costColumns = [&](const CostCounter& cost) {
+            out += ',';
+            appendNumber(out, (long long)cost.histogram.percentile(50));
+            out += ',';
+            appendNumber(out, (long long)cost.histogram.percentile(99));
+        };
+        for (size_t i = 0; i < self->collectors.size(); ++i)
+            costColumns(self->collectors[i].cost);
+        costColumns(self->output);
+    }
+    out += '\n';
+}
+
+/**
+ * @brief Command line options.
+ */
+struct Options {
+    int hz = 0;             ///< High-frequency sampling rate, 0 to disable
+    bool hzCPU = true;      ///< Sample CPU usage in high-frequency mode
+    bool hzNetwork = true;  ///< Sample network rates in high-frequency mode
+    bool braille = false;   ///< Draw history with Braille graphs
+    bool selfStats = false; ///< Start with the self-monitoring overlay
+    string trace;           ///< Chrome trace output file, empty for none
+    SystemPaths paths;      ///< Where /proc and /sys are read from
+    bool daemon = false;    ///< Run as termistatd: collect and serve snapshots, no terminal
+    bool local = false;     ///< Collect in this process even if termistatd is running
+    string socket;          ///< termistatd socket, empty for defaultSocketPath()
+    bool shm = false;       ///< Publish snapshots into the TERMISTAT_SHM_NAME segment
+    string listen;          ///< HOST:PORT to serve Prometheus metrics on, empty for none
+    string textfile;        ///< Directory to write termistat.prom into, empty for none
+    double textfileEpsilon = 0.05; ///< Change, relative to a series' largest value, that rewrites the textfile
+    OutputFormat format = OutputFormat::Terminal;   ///< Headless record format, or the terminal view
+    chrono::milliseconds interval{1000};            ///< Time between headless records
+};
+
+/**
+ * @brief Prints command line help.
+ */
+void printUsage(const char* program) {
+    cout << "Usage: " << program << " [options]\n"
+         << "  --hz N               sample at N Hz (1-" << HzSampler::MaxHz << ") between frames\n"
+         << "  --hz-metrics LIST    comma separated metrics for --hz: cpu,net (default: both)\n"
+         << "  --braille            draw history as Braille line graphs instead of sparklines\n"
+         << "  --self-stats         show termistat's own CPU, memory, read/write call and timing cost;\n"
+         << "                       added to --format records, logged to stderr by termistatd\n"
+         << "  --trace FILE         write collector and render timings as Chrome trace JSON\n"
+         << "  --proc-root DIR      read procfs from DIR instead of /proc (e.g. /host/proc)\n"
+         << "  --sys-root DIR       read sysfs from DIR instead of /sys (e.g. /host/sys)\n"
+         << "  --root DIR           query filesystem space under DIR, where the watched system's /\n"
+         << "                       is mounted (e.g. /host); mounts and network are read from\n"
+         << "                       PID 1 under --proc-root, so they are the host's as well\n"
+         << "  --daemon             collect once and serve snapshots to viewers (default when run as termistatd)\n"
+         << "  --socket PATH        termistatd socket (default: $XDG_RUNTIME_DIR/termistatd.sock,\n"
+         << "                       or /run/termistatd.sock for root)\n"
+         << "  --local              collect in this process even if termistatd is running;\n"
+         << "                       implied by --hz, the roots, --shm, --listen and --textfile\n"
+         << "  --shm                publish metrics to shared memory /dev/shm" << TERMISTAT_SHM_NAME
+         << " (see termistat_shm.h)\n"
+         << "  --listen ADDR:PORT   serve Prometheus metrics at http://ADDR:PORT/metrics (e.g. :9101)\n"
+         << "  --textfile DIR       write DIR/termistat.prom for node_exporter's textfile collector\n"
+         << "  --textfile-epsilon X rewrite it when a gauge changes by more than X times the\n"
+         << "                       largest it has been (default: 0.05; 0 on every change),\n"
+         << "                       a counter changes, or at least once a minute\n"
+         << "  --format FORMAT      write one record per interval to stdout instead of the\n"
+         << "                       terminal view: jsonl (JSON Lines) or csv\n"
+         << "  --interval MS        milliseconds between --format records (default: 1000)\n"
+         << "  -h, --help           show this help\n";
+}
+
+/**
+ * @brief Parses command line arguments.
+ *
+ * @return false if the arguments are invalid; a message has been printed.
+ */
+bool parseOptions(int argc, char** argv, Options& opts) {
+    string_view program = argv[0];
+    opts.daemon = program.substr(program.rfind('/') + 1) == "termistatd";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--hz" && hasValue) {
+            opts.hz = atoi(argv[++i]);
+            opts.local = true;
+            if (opts.hz < 1 || opts.hz > HzSampler::MaxHz) {
+                cerr << "--hz must be between 1 and " << HzSampler::MaxHz << "\n";
+                return false;
+            }
+        } else if (arg == "--hz-metrics" && hasValue) {
+            string list = argv[++i];
+            opts.hzCPU = list.find("cpu") != string::npos;
+            opts.hzNetwork = list.find("net") != string::npos;
+            if (!opts.hzCPU && !opts.hzNetwork) {
+                cerr << "--hz-metrics expects cpu, net or cpu,net\n";
+                return false;
+            }
+        } else if (arg == "--braille") {
+            opts.braille = true;
+        } else if (arg == "--self-stats") {
+            opts.selfStats = true;
+        } else if (arg == "--trace" && hasValue) {
+            opts.trace = argv[++i];
+        } else if ((arg == "--proc-root" || arg == "--sys-root" || arg == "--root") && hasValue) {
+            string root = argv[++i];
+            error_code ec;
+            if (!filesystem::is_directory(root, ec)) {
+                cerr << arg << ": " << root << " is not a directory\n";
+                return false;
+            }
+            while (root.size() > 1 && root.back() == '/')
+                root.pop_back();
+            if (root == "/")
+                root.clear(); // paths are joined with '/'
+            if (arg == "--root")
+                opts.paths.rootfs = root;
+            else
+                (arg == "--proc-root" ? opts.paths.procRoot : opts.paths.sysRoot) = root;
+            opts.local = true;
+        } else if (arg == "--daemon") {
+            opts.daemon = true;
+        } else if (arg == "--local") {
+            opts.local = true;
+        } else if (arg == "--socket" && hasValue) {
+            opts.socket = argv[++i];
+        } else if (arg == "--shm") {
+            opts.shm = true;
+            opts.local = true;
+        } else if (arg == "--listen" && hasValue) {
+            opts.listen = argv[++i];
+            opts.local = true;
+        } else if (arg == "--textfile" && hasValue) {
+            opts.textfile = argv[++i];
+            opts.local = true;
+        } else if (arg == "--format" && hasValue) {
+            string format = argv[++i];
+            if (format == "jsonl") {
+                opts.format = OutputFormat::JsonLines;
+            } else if (format == "csv") {
+                opts.format = OutputFormat::Csv;
+            } else {
+                cerr << "--format expects jsonl or csv\n";
+                return false;
+            }
+        } else if (arg == "--interval" && hasValue) {
+            opts.interval = chrono::milliseconds(atoi(argv[++i]));
+            if (opts.interval < chrono::milliseconds(10)) {
+                cerr << "--interval must be at least 10 ms\n";
+                return false;
+            }
+        } else if (arg == "--textfile-epsilon" && hasValue) {
+            char* end = nullptr;
+            opts.textfileEpsilon = strtod(argv[++i], &end);
+            if (*end != '\0' || !(opts.textfileEpsilon >= 0)) {
+                cerr << "--textfile-epsilon must be a number of at least 0\n";
+                return false;
+            }
+        } else {
+            if (arg != "-h" && arg != "--help")
+                cerr << "Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Opens the exporters requested on the command line.
+ *
+ * @return false if one could not be opened; a message has been printed.
+ */
+bool openExporters(const Options& opts, vector<unique_ptr<Exporter>>& exporters, const char* prefix) {
+    if (opts.shm)
+        exporters.push_back(make_unique<SharedMetrics>());
+    if (!opts.listen.empty())
+        exporters.push_back(make_unique<MetricsServer>(opts.listen));
+    if (!opts.textfile.empty())
+        exporters.push_back(make_unique<TextfileExporter>(opts.textfile, opts.textfileEpsilon));
+    for (const auto& exporter : exporters) {
+        if (!exporter->error().empty()) {
+            cerr << prefix << exporter->error() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Connects to termistatd unless --local, so its snapshots are shown instead of collecting again.
+ *
+ * Without --socket only the private defaultSocketPath() is tried, and
+ * only a daemon run by this user or root is accepted.
+ *
+ * @return false if an explicitly given socket is unreachable or untrusted; a message has been printed.
+ */
+bool connectDaemon(const Options& opts, unique_ptr<SnapshotClient>& daemon) {
+    if (opts.local)
+        return true;
+    bool explicitPath = !opts.socket.empty();
+    string path = explicitPath ? opts.socket : defaultSocketPath();
+    if (path.empty())
+        return true;
+    int fd = connectUnix(path);
+    if (fd < 0) {
+        if (explicitPath)
+            cerr << "Cannot connect to termistatd at " << path << "\n";
+        return !explicitPath;
+    }
+    uid_t uid = 0;
+    if (!trustedPeer(fd, uid)) {
+        close(fd);
+        cerr << "Ignoring termistatd at " << path << ": it runs as uid " << uid << ", not as you or root\n";
+        return !explicitPath;
+    }
+    daemon = make_unique<SnapshotClient>(fd);
+    return true;
+}
+
+/**
+ * @brief Where a run gets its snapshots from, and the exporters they are published to.
+ *
+ * Shared by termistatd, the headless formats and the terminal view, which
+ * differ only in what they do with each snapshot. Snapshots come from
+ * termistatd when connected, otherwise from collectors run here.
+ */
+struct CollectionContext {
+    unique_ptr<SnapshotClient> daemon;
+    CollectorRegistry registry;
+    unique_ptr<CollectorScheduler> scheduler;   ///< Only when collecting here
+    unique_ptr<HzSampler> sampler;              ///< With --hz, when collecting here
+    vector<unique_ptr<Exporter>> exporters;
+    Clock::time_point nextPublish;
+
+    /**
+     * @brief Connects to termistatd if @p viewer, opens the exporters and starts collecting unless connected.
+     *
+     * Exporters added beforehand are kept and checked too.
+     *
+     * @return false if something could not be set up; a message has been printed.
+     */
+    bool open(const Options& opts, const char* prefix, bool viewer) {
+        if (viewer && !connectDaemon(opts, daemon))
+            return false;
+        if (!openExporters(opts, exporters, prefix))
+            return false;
+        if (!daemon) {
+            registerDefaultCollectors(registry, opts.paths);
+            scheduler = make_unique<CollectorScheduler>(registry);
+            if (opts.hz > 0)
+                sampler = make_unique<HzSampler>(opts.hz, opts.hzCPU, opts.hzNetwork, opts.paths);
+        }
+        nextPublish = Clock::now() + FirstSnapshotDelay;
+        return true;
+    }
+
+    /// Whether there is a snapshot yet; until termistatd sends its first frame there is not.
+    bool ready() const { return !daemon || daemon->received(); }
+
+    Snapshot current() { return daemon ? daemon->latest() : registry.assemble(); }
+
+    /// The current snapshot with the bursts --hz sampled since the last call.
+    Snapshot sampled() {
+        Snapshot snap = current();
+        if (sampler)
+            sampler->summarize(snap.burst);
+        return snap;
+    }
+
+    /// Descriptor of the termistatd connection for poll(), or -1.
+    int daemonFd() const { return daemon ? daemon->fd() : -1; }
+
+    bool publishDue(Clock::time_point now) const {
+        return !exporters.empty() && now >= nextPublish && ready();
+    }
+
+    /**
+     * @brief Hands @p snap to every exporter and schedules the next publish tick.
+     */
+    void publish(const Snapshot& snap, Clock::time_point now) {
+        for (const auto& exporter : exporters)
+            exporter->publish(snap);
+        advanceDeadline(nextPublish, now, PublishInterval);
+    }
+
+    /**
+     * @brief @p deadline, or the next publish tick if that comes first.
+     *
+     * Until the first termistatd frame nothing is due, so the loop sleeps
+     * until the frame wakes its poll() rather than spinning on past deadlines.
+     */
+    Clock::time_point wake(Clock::time_point deadline) const {
+        if (!ready())
+            return Clock::now() + chrono::seconds(1);
+        return exporters.empty() ? deadline : min(deadline, nextPublish);
+    }
+};
+
+/// How often termistatd --self-stats logs its own cost.
+constexpr chrono::seconds SelfStatsLogInterval{10};
+
+/**
+ * @brief Runs termistatd: collects once and streams snapshots to every attached viewer.
+ *
+ * Every collector stays enabled, since each viewer may show any panel;
+ * the cost of collecting and encoding does not depend on how many viewers
+ * are attached.
+ *
+ * @return Process exit status.
+ */
+int runDaemon(const Options& opts) {
+    string path = opts.socket.empty() ? defaultSocketPath() : opts.socket;
+    if (path.empty()) {
+        cerr << "termistatd: XDG_RUNTIME_DIR is not set; pass --socket PATH in a directory only you can write to\n";
+        return 1;
+    }
+    CollectionContext context;
+    context.exporters.push_back(make_unique<SnapshotServer>(path));
+    if (!context.open(opts, "termistatd: ", false))
+        return 1;
+    installStopHandlers();
+    cerr << "termistatd: serving " << path << "\n";
+
+    // With --self-stats the daemon's own cost is logged to stderr as JSON Lines
+    SelfMonitor monitor;
+    CostCounter publishCost;
+    SelfStatsSource self{ monitor.stats(), context.registry, publishCost, "publish" };
+    Clock::time_point nextSelfStats = Clock::now() + SelfStatsLogInterval;
+    string selfRecord;
+
+    vector<pollfd> fds;
+    while (!stopRequested) {
+        Clock::time_point now = Clock::now();
+        if (context.publishDue(now)) {
+            {
+                ScopedTimer timer(publishCost, "publish", "output");
+                context.publish(context.sampled(), now);
+            }
+            monitor.frame(0);
+            if (opts.selfStats && now >= nextSelfStats) {
+                auto wallTime = chrono::system_clock::now().time_since_epoch();
+                selfRecord = "{\"time_ms\":";
+                appendNumber(selfRecord, (long long)chrono::duration_cast<chrono::milliseconds>(wallTime).count());
+                selfRecord += ",\"self\":";
+                writeJsonSelfStats(self, selfRecord);
+                selfRecord += "}\n";
+                writeAll(STDERR_FILENO, selfRecord.data(), selfRecord.size());
+                nextSelfStats = now + SelfStatsLogInterval;
+            }
+            if (activeTrace)
+                activeTrace->flush();
+        }
+        fds.clear();
+        pollWithExporters(fds, context.exporters,
+                          chrono::ceil<chrono::milliseconds>(context.nextPublish - Clock::now()));
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes all of @p data to standard output, normally in a single write().
+ *
+ * @return false once the reader has gone away.
+ */
+bool writeRecord(string_view data) {
+    while (!data.empty()) {
+        ssize_t n = write(STDOUT_FILENO, data.data(), data.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Runs --format: writes one record per interval to standard output, no terminal.
+ *
+ * Each record is serialised into a reused buffer and written with one
+ * write(), so a pipeline sees whole lines even at high rates. Records come
+ * from termistatd when it is running, as in the terminal view.
+ *
+ * @return Process exit status; 0 also when the reader closes the pipe.
+ */
+int runHeadless(const Options& opts) {
+    CollectionContext context;
+    if (!context.open(opts, "", true))
+        return 1;
+    installStopHandlers();
+
+    SelfMonitor monitor;
+    CostCounter recordCost;
+    SelfStatsSource selfSource{ monitor.stats(), context.registry, recordCost, "record" };
+    const SelfStatsSource* self = opts.selfStats ? &selfSource : nullptr;
+
+    string record;
+    if (opts.format == OutputFormat::Csv)
+        record = csvHeader(self); // goes out with the first row
+    Clock::time_point nextRecord = context.nextPublish;
+    vector<pollfd> fds;
+    while (!stopRequested) {
+        Clock::time_point now = Clock::now();
+        if (now >= nextRecord && context.ready()) {
+            {
+                ScopedTimer timer(recordCost, "record", "output");
+                Snapshot snap = context.sampled();
+                auto wallTime = chrono::system_clock::now().time_since_epoch();
+                long long timeMs = chrono::duration_cast<chrono::milliseconds>(wallTime).count();
+                if (opts.format == OutputFormat::JsonLines)
+                    writeJsonRecord(snap, timeMs, record, self);
+                else
+                    writeCsvRecord(snap, timeMs, record, self);
+                if (!writeRecord(record))
+                    break;
+            }
+            monitor.frame(record.size());
+            record.clear();
+            if (activeTrace)
+                activeTrace->flush();
+            advanceDeadline(nextRecord, now, opts.interval);
+        }
+        if (context.publishDue(now))
+            context.publish(context.current(), now);
+
+        Clock::time_point wake = context.wake(nextRecord);
+        fds.assign({ { context.daemonFd(), POLLIN, 0 } });
+        int ready = pollWithExporters(fds, context.exporters, chrono::ceil<chrono::milliseconds>(wake - Clock::now()));
+        if (ready > 0 && fds[0].revents && !context.daemon->receive()) {
+            cerr << "termistatd closed the connection\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifndef TERMISTAT_NO_MAIN
+/**
+ * @brief Main application loop.
+ *
+ * Collectors run in the background at their own deadlines; the main thread
+ * renders the latest published results at the interval picked with - and +.
+ */
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts))
+        return 1;
+
+    using namespace std::chrono_literals;
+    const auto historyInterval = 1s;     // finest history tier
+
+    unique_ptr<TraceWriter> trace; // declared first, so it outlives the threads that record into it
+    if (!opts.trace.empty()) {
+        trace = make_unique<TraceWriter>(opts.trace);
+        if (!trace->ok()) {
+            cerr << "Cannot write trace file " << opts.trace << "\n";
+            return 1;
+        }
+        activeTrace = trace.get();
+    }
+
+    if (opts.daemon)
+        return runDaemon(opts);
+
+    if (opts.format != OutputFormat::Terminal)
+        return runHeadless(opts);
+
+    CollectionContext context;
+    if (!context.open(opts, "", true))
+        return 1;
+
+    setNonBlocking(true);
+    installTerminalHandlers(!context.exporters.empty());
+
+    Clock::time_point nextRender = context.nextPublish;
+    MetricHistory history(Clock::now());
+    ViewSettings view;
+    view.caps = detectTerminalCaps();
+    if (view.caps.cursorAddressing) {
+        view.caps.synchronizedOutput = probeSynchronizedOutput();
+        if (isatty(STDOUT_FILENO))
+            enterFullScreen();
+    }
+    view.brailleGraphs = opts.braille;
+    view.selfStats = opts.selfStats;
+    if (view.caps.unicode)
+        view.barWidth = 24; // eighth blocks give 8x the resolution of whole cells
+    Clock::time_point nextRecord = nextRender;
+    Renderer renderer(context.registry);
+    Controls controls;
+    Snapshot shown; // kept while paused, so filters and toggles can still be redrawn
+    InputParser parser;
+    vector<InputEvent> events;
+    bool inputOpen = true;
+    Clock::time_point lastInput;
+    vector<pollfd> fds;
+
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= nextRecord && context.ready()) {
+            history.record(context.current());
+            advanceDeadline(nextRecord, now, historyInterval);
+        }
+        if (context.publishDue(now))
+            context.publish(context.current(), now);
+
+        if (controls.paused && context.sampler)
+            context.sampler->discard();
+        bool due = !controls.paused && now >= nextRender;
+        if (due || controls.redraw || terminalResized) {
+            if (!controls.paused)
+                shown = context.sampled();
+            renderer.render(shown, history, view, controls, controls.interval());
+            if (context.scheduler)
+                updateCollectorDemand(view, renderer, context.registry, *context.scheduler, context.sampler.get(),
+                                      !context.exporters.empty());
+            if (trace)
+                trace->flush();
+            Clock::duration interval = renderer.frameInterval(controls.interval());
+            if (due)
+                nextRender += interval;
+            if (nextRender < now || controls.redraw)
+                nextRender = now + interval;
+            controls.redraw = false;
+        }
+
+        // Sleep until the next deadline, waking early only for input, a daemon frame or a signal
+        Clock::time_point wake = context.wake(nextRecord);
+        if (!controls.paused)
+            wake = min(wake, nextRender);
+        if (parser.pending())
+            wake = min(wake, lastInput + InputParser::EscapeTimeout);
+        auto timeout = chrono::ceil<chrono::milliseconds>(wake - Clock::now());
+        fds.assign({ { inputOpen ? STDIN_FILENO : -1, POLLIN, 0 },
+                     { context.daemonFd(), POLLIN, 0 } });
+        int ready = pollWithExporters(fds, context.exporters, timeout);
+        if (ready > 0 && fds[0].revents) {
+            inputOpen = readInput(parser, events) && !(fds[0].revents & (POLLHUP | POLLERR | POLLNVAL));
+            lastInput = Clock::now();
+        } else if (parser.pending() && Clock::now() >= lastInput + InputParser::EscapeTimeout) {
+            parser.flush(events);
+        }
+        if (ready > 0 && fds[1].revents && !context.daemon->receive()) {
+            restoreTerminal();
+            cerr << "termistatd closed the connection\n";
+            return 1;
+        }
+
+        for (const InputEvent& event : events)
+            handleInput(event, controls, view, renderer);
+        events.clear();
+        if (controls.quit || stopRequested)
+            break;
+    }
+    restoreTerminal();
+    return 0;
+}
+#endif // TERMISTAT_NO_MAIN
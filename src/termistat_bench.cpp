@@ -0,0 +1,699 @@
+/**
+ * @file termistat_bench.cpp
+ * @brief Benchmarks for the parsers and renderers of termistat.
+ *
+ * Builds the program source without its main(), generates synthetic /proc
+ * and /sys trees sized like a large host (256 CPUs, 5k interfaces, 10k
+ * mounts, 64 disks, 100k processes) and times every parser against them
+ * through SystemPaths, then every renderer
+ * against what the parsers produced. Each row reports time, heap
+ * allocations and read/write-family system calls per operation.
+ *
+ * Usage: termistat_bench [fixture-dir]
+ *
+ * With a directory the fixture tree is generated there and kept, so it can
+ * also be watched with "termistat --proc-root DIR/proc --sys-root DIR/sys";
+ * otherwise it goes to a temporary directory that is removed afterwards.
+ * The generators are deterministic, so runs on the same machine compare.
+ */
+#define TERMISTAT_NO_MAIN
+#include "termistat.cpp"
+
+#include <dirent.h>
+#include <filesystem>
+#include <iomanip>
+
+/// Heap allocations made through operator new since the start.
+atomic<uint64_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+// Out of line, so GCC does not pair the inlined free() with operator new and warn
+[[gnu::noinline]] void operator delete(void* p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { free(p); }
+
+/// Results are folded in here so the optimizer cannot drop the work.
+volatile size_t benchSink;
+
+/**
+ * @brief Read- and write-family system calls made so far (syscr + syscw of /proc/self/io).
+ *
+ * open, close, stat, poll, ioctl and directory reads are not counted by
+ * the kernel here.
+ */
+uint64_t readWriteCalls() {
+    static ProcFile io("/proc/self/io");
+    string_view text = io.readAll();
+    uint64_t total = 0;
+    for (string_view key : { "syscr:", "syscw:" }) {
+        size_t pos = text.find(key);
+        if (pos == string_view::npos) continue;
+        const char* p = text.data() + pos + key.size();
+        total += parseNumber(p, text.data() + text.size());
+    }
+    return total;
+}
+
+/**
+ * @brief Cost of one operation.
+ */
+struct OpCost {
+    double ns = 0;
+    double allocations = 0;
+    double readWriteCalls = 0;
+};
+
+/**
+ * @brief Runs @p body @p iterations times after one warm-up call and returns the cost per call.
+ */
+template <typename Body>
+OpCost measure(size_t iterations, Body&& body) {
+    // Reading /proc/self/io costs read calls of its own; measure them once
+    static const uint64_t probe = [] { uint64_t a = readWriteCalls(); return readWriteCalls() - a; }();
+
+    body(0);
+    uint64_t allocations = allocationCount.load(memory_order_relaxed);
+    uint64_t calls = readWriteCalls();
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        body(i);
+    auto elapsed = chrono::duration<double, nano>(Clock::now() - start);
+    uint64_t callsAfter = readWriteCalls();
+    uint64_t allocationsAfter = allocationCount.load(memory_order_relaxed);
+
+    OpCost cost;
+    cost.ns = elapsed.count() / iterations;
+    cost.allocations = double(allocationsAfter - allocations) / iterations;
+    cost.readWriteCalls = double(callsAfter - calls - min(probe, callsAfter - calls)) / iterations;
+    return cost;
+}
+
+/**
+ * @brief Prints the heading of a group of results.
+ */
+void section(const string& title) {
+    cout << '\n' << left << setw(40) << title << right << setw(14) << "ns/op" << setw(12) << "allocs/op"
+         << setw(12) << "rw calls/op" << '\n';
+}
+
+/**
+ * @brief Prints one result row.
+ */
+void report(const string& name, const OpCost& cost) {
+    cout << "  " << left << setw(38) << name << right << fixed << setprecision(1) << setw(14) << cost.ns
+         << setw(12) << cost.allocations << setw(12) << cost.readWriteCalls << endl;
+}
+
+/**
+ * @brief Directory tree holding the generated fixtures.
+ */
+class FixtureTree {
+public:
+    /**
+     * @param dir Directory to generate into and keep, or empty for a temporary one.
+     */
+    explicit FixtureTree(const string& dir) : keep_(!dir.empty()) {
+        if (keep_) {
+            root_ = filesystem::absolute(dir).string();
+            filesystem::create_directories(root_);
+        } else {
+            string pattern = filesystem::temp_directory_path().string() + "/termistat-bench-XXXXXX";
+            if (!mkdtemp(pattern.data()))
+                throw runtime_error("cannot create a fixture directory");
+            root_ = pattern;
+
+            // /proc lives in memory, so keep the files on tmpfs where there is one. The tree is
+            // still reached through the temporary directory, as collectDisks skips paths under /dev.
+            error_code failed;
+            string shm = "/dev/shm" + root_.substr(root_.rfind('/'));
+            if (filesystem::create_directory(shm, failed)) {
+                filesystem::remove(root_, failed);
+                filesystem::create_directory_symlink(shm, root_, failed);
+                if (failed) {
+                    filesystem::remove(shm, failed);
+                    filesystem::create_directory(root_);
+                } else {
+                    storage_ = shm;
+                }
+            }
+        }
+    }
+
+    ~FixtureTree() {
+        if (!keep_) {
+            error_code ignored;
+            filesystem::remove_all(storage_.empty() ? root_ : storage_, ignored);
+            filesystem::remove(root_, ignored);
+        }
+    }
+
+    /// Absolute path of @p relative inside the tree.
+    string path(const string& relative) const { return root_ + "/" + relative; }
+
+    /**
+     * @brief Writes @p content to @p relative, creating parent directories.
+     */
+    void write(const string& relative, const string& content) const {
+        string file = path(relative);
+        filesystem::create_directories(filesystem::path(file).parent_path());
+        ofstream out(file, ios::binary | ios::trunc);
+        out << content;
+        if (!out)
+            throw runtime_error("cannot write " + file);
+    }
+
+private:
+    string root_;
+    string storage_;    ///< Directory on tmpfs that root_ links to, if any
+    bool keep_;
+};
+
+/**
+ * @brief Deterministic pseudo-random numbers for fixture contents.
+ */
+class FixtureRandom {
+public:
+    /// Next value in [0, @p bound).
+    unsigned long long next(unsigned long long bound) {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (state_ >> 17) % bound;
+    }
+
+private:
+    unsigned long long state_ = 0x7465726d69737461ULL;
+};
+
+/**
+ * @brief Writes proc/stat for @p cpus CPUs.
+ */
+void writeProcStat(const FixtureTree& tree, int cpus) {
+    FixtureRandom random;
+    string text;
+    auto cpuLine = [&](const string& name, unsigned long long scale) {
+        text += name;
+        for (int field = 0; field < 10; ++field)
+            text += ' ' + to_string(random.next(1000000) * scale);
+        text += '\n';
+    };
+    cpuLine("cpu ", cpus);
+    for (int cpu = 0; cpu < cpus; ++cpu)
+        cpuLine("cpu" + to_string(cpu), 1);
+    text += "intr 1234567890";
+    for (int irq = 0; irq < 512; ++irq)
+        text += ' ' + to_string(random.next(100000));
+    text += "\nctxt 98765432101\nbtime 1700000000\nprocesses 4000000\nprocs_running 3\nprocs_blocked 0\n";
+    text += "softirq 123456789 0 1 2 3 4 5 6 7 8 9\n";
+    tree.write("proc/stat", text);
+}
+
+/**
+ * @brief Writes proc/meminfo.
+ */
+void writeMeminfo(const FixtureTree& tree) {
+    tree.write("proc/meminfo",
+               "MemTotal:       1056718848 kB\n"
+               "MemFree:         48392012 kB\n"
+               "MemAvailable:   801234567 kB\n"
+               "Buffers:          1203948 kB\n"
+               "Cached:         701928374 kB\n"
+               "SwapCached:             0 kB\n"
+               "Active:         301928374 kB\n"
+               "Inactive:       402938475 kB\n"
+               "SwapTotal:       8388604 kB\n"
+               "SwapFree:        8388604 kB\n"
+               "Dirty:               1024 kB\n"
+               "Writeback:              0 kB\n"
+               "Shmem:            2938475 kB\n"
+               "Slab:            29384756 kB\n"
+               "HugePages_Total:       0\n"
+               "Hugepagesize:       2048 kB\n");
+}
+
+/**
+ * @brief Writes proc/net/dev listing loopback and @p interfaces virtual interfaces.
+ */
+void writeNetDev(const FixtureTree& tree, int interfaces) {
+    FixtureRandom random;
+    string text =
+        "Inter-|   Receive                                                |  Transmit\n"
+        " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    char line[256];
+    for (int i = 0; i <= interfaces; ++i) {
+        string name = i == 0 ? "lo" : "veth" + to_string(i - 1);
+        snprintf(line, sizeof(line), "%6s: %llu %llu 0 0 0 0 0 0 %llu %llu 0 0 0 0 0 0\n", name.c_str(),
+                 random.next(1ULL << 40), random.next(1ULL << 30), random.next(1ULL << 40), random.next(1ULL << 30));
+        text += line;
+    }
+    tree.write("proc/net/dev", text);
+}
+
+/**
+ * @brief Writes proc/mounts with a few system mounts and @p mounts container mounts.
+ *
+ * The container mount points are created inside the tree, so statvfs
+ * succeeds on them as it would on a real host.
+ */
+void writeMounts(const FixtureTree& tree, int mounts) {
+    string text =
+        "/dev/root / ext4 rw,relatime 0 0\n"
+        "proc /proc proc rw,nosuid,nodev,noexec,relatime 0 0\n"
+        "sysfs /sys sysfs rw,nosuid,nodev,noexec,relatime 0 0\n"
+        "devtmpfs /dev devtmpfs rw,nosuid,size=4096k,mode=755 0 0\n";
+    for (int i = 0; i < mounts; ++i) {
+        string mountpoint = tree.path("mnt/c" + to_string(i));
+        filesystem::create_directories(mountpoint);
+        text += "overlay " + mountpoint + " overlay rw,relatime,lowerdir=/var/lib/l" + to_string(i) + " 0 0\n";
+        // Every hundredth container has a volume bind-mounted over it again
+        if (i % 100 == 0)
+            text += "/dev/root " + mountpoint + " ext4 rw,relatime 0 0\n";
+    }
+    tree.write("proc/mounts", text);
+}
+
+/**
+ * @brief Writes proc/diskstats and sys/block for @p disks NVMe disks.
+ *
+ * Each disk has four partitions, and sixteen loop devices are listed too,
+ * so the parser has to skip most lines as it does on a real host.
+ */
+void writeDiskstats(const FixtureTree& tree, int disks) {
+    FixtureRandom random;
+    string text;
+    char line[256];
+    auto device = [&](int major, int minor, const string& name) {
+        snprintf(line, sizeof(line), "%4d %7d %s %llu 0 %llu %llu %llu 0 %llu %llu 0 %llu %llu 0 0 0 0 0 0\n",
+                 major, minor, name.c_str(), random.next(1 << 24), random.next(1ULL << 36), random.next(1 << 24),
+                 random.next(1 << 24), random.next(1ULL << 36), random.next(1 << 24), random.next(1 << 24),
+                 random.next(1 << 24));
+        text += line;
+    };
+    for (int loop = 0; loop < 16; ++loop)
+        device(7, loop, "loop" + to_string(loop));
+    for (int disk = 0; disk < disks; ++disk) {
+        string name = "nvme" + to_string(disk) + "n1";
+        device(259, disk * 5, name);
+        for (int part = 1; part <= 4; ++part)
+            device(259, disk * 5 + part, name + "p" + to_string(part));
+        filesystem::create_directories(tree.path("sys/block/" + name));
+    }
+    tree.write("proc/diskstats", text);
+}
+
+/**
+ * @brief Writes the thermal zone, hwmon chips and battery read from sys/class.
+ *
+ * Only the last of the eight hwmon chips reports a fan, as on servers whose
+ * fan controller sits behind several temperature-only sensors.
+ */
+void writeSysClass(const FixtureTree& tree) {
+    tree.write("sys/class/thermal/thermal_zone0/temp", "47500\n");
+    for (int chip = 0; chip < 8; ++chip) {
+        string dir = "sys/class/hwmon/hwmon" + to_string(chip) + "/";
+        tree.write(dir + "name", chip < 7 ? "nvme\n" : "nct6775\n");
+        tree.write(dir + "temp1_input", "41000\n");
+        if (chip == 7)
+            tree.write(dir + "fan2_input", "1187\n");
+    }
+    tree.write("sys/class/power_supply/BAT0/capacity", "87\n");
+    tree.write("sys/class/power_supply/BAT0/status", "Discharging\n");
+}
+
+/**
+ * @brief Writes proc/[pid]/stat for @p processes processes.
+ */
+void writeProcesses(const FixtureTree& tree, int processes) {
+    FixtureRandom random;
+    char line[512];
+    for (int pid = 1; pid <= processes; ++pid) {
+        snprintf(line, sizeof(line),
+                 "%d (worker-%d) S %d %d %d 0 -1 4194560 %llu 0 0 0 %llu %llu 0 0 20 0 1 0 %llu %llu %llu "
+                 "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 %llu 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+                 pid, pid % 997, pid > 1 ? 1 + int(random.next(pid - 1)) : 0, pid, pid, random.next(100000),
+                 random.next(1000000), random.next(1000000), random.next(100000000), random.next(1ULL << 32),
+                 random.next(1ULL << 18), random.next(256));
+        tree.write("proc/" + to_string(pid) + "/stat", line);
+    }
+}
+
+/**
+ * @brief Reads the CPU time of every process under @p procRoot.
+ *
+ * termistat has no process collector; this is the floor any per-process
+ * view would pay: one directory walk plus one open, read and close of
+ * /proc/[pid]/stat per process.
+ *
+ * @return Sum of utime and stime over all processes.
+ */
+unsigned long long walkProcesses(const string& procRoot, size_t& processes) {
+    DIR* dir = opendir(procRoot.c_str());
+    if (!dir) return 0;
+    unsigned long long ticks = 0;
+    string path;
+    processes = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9')
+            continue;
+        path.assign(procRoot).append("/").append(entry->d_name).append("/stat");
+        ProcFile stat(path.c_str());
+        string_view text = stat.readHead(512);
+        size_t comm = text.rfind(')'); // the command name may contain spaces and parentheses
+        if (comm == string_view::npos) continue;
+        const char* p = text.data() + comm + 2;
+        const char* end = text.data() + text.size();
+        p += 2; // state
+        for (int field = 4; field < 14; ++field) {
+            while (p < end && *p == '-') ++p;
+            parseNumber(p, end);
+        }
+        ticks += parseNumber(p, end); // utime
+        ticks += parseNumber(p, end); // stime
+        ++processes;
+    }
+    closedir(dir);
+    return ticks;
+}
+
+/// Fixture sizes; see the file comment.
+constexpr int FixtureCPUs = 256;
+constexpr int FixtureInterfaces = 5000;
+constexpr int FixtureMounts = 10000;
+constexpr int FixtureDisks = 64;
+constexpr int FixtureProcesses = 100000;
+
+/**
+ * @brief Compares to_chars formatting with the iostream path used before.
+ */
+void benchFormatting() {
+    // Spread values over every unit so each scaling branch is exercised
+    vector<double> values;
+    for (int i = 0; i < 4096; ++i)
+        values.push_back(pow(1.0137, i % 2048) * (1 + i % 7));
+
+    const size_t iterations = 2000000;
+    size_t sink = 0;
+
+    section("number formatting");
+
+    report("ostringstream fixed(1) + unit", measure(iterations, [&](size_t i) {
+        ostringstream os;
+        os << fixed << setprecision(1) << values[i % values.size()] / (1024 * 1024) << " MB";
+        sink += os.str().size();
+    }));
+
+    ostringstream reused;
+    report("reused ostringstream", measure(iterations, [&](size_t i) {
+        reused.str(string());
+        reused << fixed << setprecision(1) << values[i % values.size()] / (1024 * 1024) << " MB";
+        sink += reused.str().size();
+    }));
+
+    report("snprintf %.1f + unit", measure(iterations, [&](size_t i) {
+        char buffer[32];
+        sink += snprintf(buffer, sizeof(buffer), "%.1f MB", values[i % values.size()] / (1024 * 1024));
+    }));
+
+    report("formatBytes", measure(iterations, [&](size_t i) {
+        sink += formatBytes(values[i % values.size()]).size;
+    }));
+
+    report("formatBitRate", measure(iterations, [&](size_t i) {
+        sink += formatBitRate(values[i % values.size()]).size;
+    }));
+
+    report("formatPercent", measure(iterations, [&](size_t i) {
+        sink += formatPercent(fmod(values[i % values.size()], 100.0)).size;
+    }));
+
+    benchSink = sink;
+}
+
+/**
+ * @brief Times InputParser on typing and on an oversized bracketed paste.
+ *
+ * Also checks that a paste longer than the parser keeps is still ended by
+ * its terminator, so the key typed after it arrives, even when the input
+ * is split at every byte.
+ */
+void benchInput() {
+    const string typed = "hjkl\033[A\033[B\033[1;5C\033[<0;10;5M\033[<0;10;5mq";
+    const string paste = "\033[200~" + string(70000, 'x') + "\033[201\033[201~q";
+    InputParser parser;
+    vector<InputEvent> events;
+    size_t sink = 0;
+
+    auto check = [&](const char* how) {
+        if (events.size() < 2 || events[events.size() - 2].type != InputEvent::Paste
+            || events.back().type != InputEvent::KeyPress || events.back().text != "q")
+            throw runtime_error(string("oversized paste ") + how + " swallowed the key after it");
+        events.clear();
+    };
+    parser.feed(paste.data(), paste.size(), events);
+    check("in one read");
+    for (char c : paste)
+        parser.feed(&c, 1, events);
+    check("split at every byte");
+
+    section("input");
+
+    report("InputParser keys (" + to_string(typed.size()) + " bytes)", measure(200000, [&](size_t) {
+        events.clear();
+        parser.feed(typed.data(), typed.size(), events);
+        sink += events.size();
+    }));
+    report("InputParser paste (" + to_string(paste.size()) + " bytes)", measure(500, [&](size_t) {
+        events.clear();
+        parser.feed(paste.data(), paste.size(), events);
+        sink += events.size();
+    }));
+
+    benchSink = sink;
+}
+
+/**
+ * @brief Times every /proc and /sys parser against the fixture tree and fills @p snap for the renderers.
+ */
+void benchParsers(const FixtureTree& tree, Snapshot& snap) {
+    size_t sink = 0;
+    SystemPaths paths;
+    paths.procRoot = tree.path("proc");
+    paths.sysRoot = tree.path("sys");
+    string stat = paths.proc("stat");
+    string meminfo = paths.proc("meminfo");
+    string netDev = paths.proc("net/dev");
+    string mounts = paths.proc("mounts");
+    string diskstats = paths.proc("diskstats");
+
+    section("parsers");
+
+    ProcFile statFile(stat.c_str());
+    report("readCPUCounters (" + to_string(FixtureCPUs) + " CPUs)", measure(100000, [&](size_t) {
+        sink += readCPUCounters(statFile).total;
+    }));
+
+    CPUCounters cpuPrev;
+    report("collectCPU", measure(100000, [&](size_t) {
+        snap.cpu = collectCPU(statFile, cpuPrev);
+    }));
+
+    report("collectMemory", measure(20000, [&](size_t) {
+        snap.memory = collectMemory(meminfo.c_str());
+    }));
+
+    NetCounters netPrev;
+    report("collectNetwork (" + to_string(FixtureInterfaces) + " interfaces)", measure(50, [&](size_t) {
+        snap.network = collectNetwork(netPrev, netDev.c_str());
+    }));
+
+    ProcFile netDevFile(netDev.c_str());
+    report("readNetTotals (" + to_string(FixtureInterfaces) + " interfaces)", measure(500, [&](size_t) {
+        sink += readNetTotals(netDevFile).rxBytes;
+    }));
+
+    report("collectDisks (" + to_string(FixtureMounts) + " mounts)", measure(10, [&](size_t) {
+        snap.disks = collectDisks(mounts.c_str());
+    }));
+
+    ProcFile diskstatsFile(diskstats.c_str());
+    DiskIOCounters diskPrev;
+    report("collectDiskIO (" + to_string(FixtureDisks) + " disks)", measure(5000, [&](size_t) {
+        snap.diskIO = collectDiskIO(diskstatsFile, diskPrev, paths);
+    }));
+
+    report("collectSensors", measure(2000, [&](size_t) {
+        snap.sensors = collectSensors(paths);
+    }));
+
+    report("readBattery", measure(20000, [&](size_t) {
+        snap.battery = readBattery(paths);
+    }));
+
+    size_t processes = 0;
+    OpCost walk = measure(3, [&](size_t) {
+        sink += walkProcesses(paths.procRoot, processes);
+    });
+    report("pid walk (" + to_string(processes) + " processes)", walk);
+
+    benchSink = sink;
+}
+
+/**
+ * @brief Times the exporter encodings on the snapshot the parsers produced.
+ */
+void benchSnapshotFrames(const Snapshot& snap) {
+    string frame, metrics;
+    Snapshot decoded;
+    size_t sink = 0;
+
+    section("exporters");
+
+    report("encodeSnapshotFrame", measure(200, [&](size_t) {
+        encodeSnapshotFrame(snap, frame);
+    }));
+    report("decodeSnapshot (" + to_string(frame.size()) + " bytes)", measure(200, [&](size_t) {
+        sink += decodeSnapshot(string_view(frame).substr(sizeof(uint32_t)), decoded);
+    }));
+    OpCost exposition = measure(200, [&](size_t) {
+        writePrometheusMetrics(snap, metrics);
+    });
+    report("writePrometheusMetrics (" + to_string(metrics.size()) + " bytes)", exposition);
+    // Alternating between two lists defeats the cache, as a new disk list does every 30 s
+    SharedList<DiskInfo> relisted(vector<DiskInfo>(snap.disks.begin(), snap.disks.end()));
+    report("firstMountpoints (" + to_string(snap.disks.size()) + " mounts)", measure(200, [&](size_t i) {
+        sink += firstMountpoints(i % 2 ? relisted : snap.disks).size();
+    }));
+    OpCost json = measure(200, [&](size_t) {
+        metrics.clear();
+        writeJsonRecord(snap, 0, metrics);
+    });
+    report("writeJsonRecord (" + to_string(metrics.size()) + " bytes)", json);
+    report("writeCsvRecord", measure(200, [&](size_t) {
+        metrics.clear();
+        writeCsvRecord(snap, 0, metrics);
+    }));
+
+    benchSink = sink;
+}
+
+/**
+ * @brief Times every renderer drawing @p snap into an off-screen frame.
+ */
+void benchRenderers(const Snapshot& snap) {
+    ViewSettings view;
+    view.caps.unicode = true;
+    view.caps.color = ColorMode::TrueColor;
+    view.barWidth = 24;
+
+    // Ten minutes of history so every graph is full
+    Clock::time_point start = Clock::now();
+    MetricHistory history(start);
+    FixtureRandom random;
+    for (int second = 0; second < 600; ++second)
+        for (int metric = 0; metric < MetricHistory::MetricCount; ++metric)
+            history.record(MetricHistory::Metric(metric), start + chrono::seconds(second), float(random.next(100)));
+
+    Screen screen;
+    screen.resize(200, 60, { 0, 100 });
+    Rect rect = { 0, 0, 100, 60 };
+    ListView<DiskInfo> disks;
+    ListView<NetInterfaceInfo> interfaces;
+    ListArea area;
+    auto diskName = [](const DiskInfo& d) -> const string& { return d.mountpoint; };
+    auto interfaceName = [](const NetInterfaceInfo& i) -> const string& { return i.name; };
+    const size_t iterations = 20000;
+
+    section("renderers");
+
+    auto panelBench = [&](const string& name, auto&& draw) {
+        report(name, measure(iterations, [&](size_t) {
+            screen.clear();
+            Panel panel(screen, rect, 0);
+            draw(panel);
+        }));
+    };
+
+    panelBench("renderMemory", [&](Panel& panel) { renderMemory(panel, snap.memory, history, view); });
+    panelBench("renderCPU", [&](Panel& panel) {
+        renderCPU(panel, snap.cpu, snap.sensors, snap.burst, history, view);
+    });
+    panelBench("renderBattery", [&](Panel& panel) { renderBattery(panel, snap.battery, view); });
+
+    view.brailleGraphs = true;
+    view.graphHeight = 4;
+    panelBench("renderCPU (Braille graph)", [&](Panel& panel) {
+        renderCPU(panel, snap.cpu, snap.sensors, snap.burst, history, view);
+    });
+    view.brailleGraphs = false;
+
+    for (SortKey sort : { SortKey::Natural, SortKey::Name, SortKey::Usage }) {
+        static const char* const names[] = { "natural", "by name", "by usage" };
+        string order = names[size_t(sort)];
+        panelBench("renderDisks (" + to_string(snap.disks.size()) + ", " + order + ")", [&](Panel& panel) {
+            disks.reset(snap.disks, view.filter, diskName, DiskOrders[size_t(sort)], false);
+            renderDisks(panel, disks, snap.diskIO, history, view, area);
+        });
+        panelBench("renderNetwork (" + to_string(snap.network.interfaces.size()) + ", " + order + ")",
+                   [&](Panel& panel) {
+            interfaces.reset(snap.network.interfaces, view.filter, interfaceName, InterfaceOrders[size_t(sort)], false);
+            renderNetwork(panel, snap.network, interfaces, snap.wifiSignal, snap.burst, history, view, area);
+        });
+    }
+
+    view.filter = "veth4";
+    panelBench("renderNetwork (filtered)", [&](Panel& panel) {
+        interfaces.reset(snap.network.interfaces, view.filter, interfaceName, nullptr, false);
+        renderNetwork(panel, snap.network, interfaces, snap.wifiSignal, snap.burst, history, view, area);
+    });
+    view.filter.clear();
+
+    // Fill both columns, then time joining them into the frame bytes
+    screen.clear();
+    Panel left(screen, rect, 0);
+    renderCPU(left, snap.cpu, snap.sensors, snap.burst, history, view);
+    renderMemory(left, snap.memory, history, view);
+    Panel right(screen, { 100, 0, 100, 60 }, 1);
+    interfaces.reset(snap.network.interfaces, view.filter, interfaceName, nullptr, false);
+    renderNetwork(right, snap.network, interfaces, snap.wifiSignal, snap.burst, history, view, area);
+    string frame;
+    report("Screen::compose (200x60)", measure(iterations, [&](size_t) {
+        frame.clear();
+        screen.compose(frame, view.caps);
+    }));
+    benchSink = frame.size();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        cerr << "Usage: " << argv[0] << " [fixture-dir]\n";
+        return 1;
+    }
+
+    try {
+        FixtureTree tree(argc == 2 ? argv[1] : "");
+        auto start = Clock::now();
+        writeProcStat(tree, FixtureCPUs);
+        writeMeminfo(tree);
+        writeNetDev(tree, FixtureInterfaces);
+        writeMounts(tree, FixtureMounts);
+        writeDiskstats(tree, FixtureDisks);
+        writeSysClass(tree);
+        writeProcesses(tree, FixtureProcesses);
+        cout << "fixtures generated in " << fixed << setprecision(1)
+             << chrono::duration<double>(Clock::now() - start).count() << " s at " << tree.path("") << '\n';
+
+        benchFormatting();
+        benchInput();
+        Snapshot snap;
+        benchParsers(tree, snap);
+        benchSnapshotFrames(snap);
+        benchRenderers(snap);
+    } catch (const exception& e) {
+        cerr << "termistat_bench: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file termistat_shm.h
+ * @brief Layout of the shared-memory metrics segment published by termistat --shm.
+ *
+ * termistat (or termistatd) keeps the latest snapshot in the POSIX shared
+ * memory object TERMISTAT_SHM_NAME (/dev/shm/termistat on Linux). Local
+ * processes map it read-only and copy the metrics out without syscalls or
+ * parsing:
+ *
+ * @code
+ * int fd = shm_open(TERMISTAT_SHM_NAME, O_RDONLY, 0);
+ * const struct termistat_shm *shm = mmap(NULL, sizeof *shm, PROT_READ, MAP_SHARED, fd, 0);
+ * struct termistat_shm copy;
+ * uint64_t age_ns;
+ * if (termistat_shm_valid(shm) && termistat_shm_read(shm, &copy, &age_ns) == 0
+ *     && age_ns < TERMISTAT_SHM_STALE_NS)
+ *     printf("cpu %.1f%%\n", copy.cpu_usage);
+ * @endcode
+ *
+ * The segment is guarded by a seqlock: the writer makes @c sequence odd
+ * while it updates the metrics and even again when done, so a copy taken
+ * between two equal, even reads of @c sequence is consistent.
+ *
+ * A writer that is killed outright cannot remove the segment, which then
+ * keeps its last, valid-looking contents. The writer updates the segment
+ * four times a second, so a copy older than TERMISTAT_SHM_STALE_NS means
+ * nobody is publishing any more.
+ *
+ * All fields have fixed sizes and native byte order. The layout only
+ * changes together with TERMISTAT_SHM_VERSION; readers must check it.
+ */
+#ifndef TERMISTAT_SHM_H
+#define TERMISTAT_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define TERMISTAT_SHM_NAME "/termistat"
+#define TERMISTAT_SHM_MAGIC 0x4d485354u         /**< "TSHM" */
+#define TERMISTAT_SHM_VERSION 1u
+
+#define TERMISTAT_SHM_MAX_DISKS 256             /**< Disks stored; disk_count may be larger */
+#define TERMISTAT_SHM_MAX_INTERFACES 256        /**< Interfaces stored; interface_count may be larger */
+#define TERMISTAT_SHM_NAME_SIZE 64              /**< Bytes per name, NUL-terminated, truncated to fit */
+#define TERMISTAT_SHM_STALE_NS 2000000000ull    /**< Age after which the writer is taken to be gone */
+
+/**
+ * @brief Space usage of one mounted filesystem.
+ */
+struct termistat_shm_disk {
+    char mountpoint[TERMISTAT_SHM_NAME_SIZE];
+    uint64_t total_bytes;
+    uint64_t used_bytes;
+};
+
+/**
+ * @brief Counters and rates of one network interface.
+ */
+struct termistat_shm_interface {
+    char name[TERMISTAT_SHM_NAME_SIZE];
+    int64_t rx_bytes;                           /**< Received bytes since boot */
+    int64_t tx_bytes;                           /**< Transmitted bytes since boot */
+    double rx_rate;                             /**< Received bytes per second */
+    double tx_rate;                             /**< Transmitted bytes per second */
+};
+
+/**
+ * @brief The whole segment.
+ */
+struct termistat_shm {
+    /* Header, written once when the segment is created */
+    uint32_t magic;                             /**< TERMISTAT_SHM_MAGIC */
+    uint32_t version;                           /**< TERMISTAT_SHM_VERSION */
+    uint32_t size;                              /**< sizeof(struct termistat_shm) */
+    uint32_t writer_pid;                        /**< Process publishing into the segment */
+
+    uint64_t sequence;                          /**< Seqlock; odd while an update is in progress */
+
+    /* Metrics, valid when read under the seqlock */
+    uint64_t updated_ns;                        /**< CLOCK_REALTIME of the last update */
+    uint64_t updates;                           /**< Updates published so far */
+
+    int64_t mem_total_kb;
+    int64_t mem_available_kb;
+    float cpu_usage;                            /**< Percent, 0-100 */
+    float temperature_c;                        /**< -1 if unavailable */
+    int32_t fan_rpm;                            /**< -1 if unavailable */
+    int32_t battery_capacity;                   /**< Percent, -1 if unavailable */
+    char battery_status[16];                    /**< "Charging", "Discharging", ...; empty if unavailable */
+
+    double disk_read_rate;                      /**< Bytes per second, whole disks */
+    double disk_write_rate;
+    double net_rx_rate;                         /**< Bytes per second, all interfaces but lo */
+    double net_tx_rate;
+
+    uint32_t disk_count;                        /**< Filesystems found */
+    uint32_t interface_count;                   /**< Interfaces found */
+    struct termistat_shm_disk disks[TERMISTAT_SHM_MAX_DISKS];
+    struct termistat_shm_interface interfaces[TERMISTAT_SHM_MAX_INTERFACES];
+};
+
+/**
+ * @brief Whether @p shm was created by a writer with this layout.
+ */
+static inline int termistat_shm_valid(const struct termistat_shm *shm) {
+    return shm->magic == TERMISTAT_SHM_MAGIC && shm->version == TERMISTAT_SHM_VERSION
+        && shm->size == sizeof(struct termistat_shm);
+}
+
+/**
+ * @brief Copies a consistent snapshot of @p shm into @p out.
+ *
+ * @param age_ns If not NULL, receives how long ago the copied metrics were
+ *        published, from @c updated_ns; compare it with
+ *        TERMISTAT_SHM_STALE_NS to tell a live writer from a dead one.
+ * @return 0 on success, -1 if the writer kept the segment busy for every attempt.
+ */
+static inline int termistat_shm_read(const struct termistat_shm *shm, struct termistat_shm *out,
+                                     uint64_t *age_ns) {
+    int attempt;
+    for (attempt = 0; attempt < 1000; ++attempt) {
+        uint64_t before = __atomic_load_n(&shm->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+            continue;
+        memcpy(out, (const void *)shm, sizeof *out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->sequence, __ATOMIC_RELAXED) == before) {
+            if (age_ns) {
+                struct timespec now;
+                uint64_t now_ns;
+                clock_gettime(CLOCK_REALTIME, &now);
+                now_ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+                *age_ns = now_ns > out->updated_ns ? now_ns - out->updated_ns : 0;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#endif /* TERMISTAT_SHM_H */